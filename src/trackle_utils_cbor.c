@@ -0,0 +1,110 @@
+#include <string.h>
+
+#include "trackle_utils_internal.h"
+
+size_t trackleUtilsCborEncodeHead(uint8_t *out, uint8_t majorType, uint64_t argument)
+{
+    const uint8_t type = majorType << 5;
+    int argumentBytes;
+    if (argument < 24)
+    {
+        out[0] = type | (uint8_t)argument;
+        return 1;
+    }
+    else if (argument <= UINT8_MAX)
+    {
+        out[0] = type | 24;
+        argumentBytes = 1;
+    }
+    else if (argument <= UINT16_MAX)
+    {
+        out[0] = type | 25;
+        argumentBytes = 2;
+    }
+    else if (argument <= UINT32_MAX)
+    {
+        out[0] = type | 26;
+        argumentBytes = 4;
+    }
+    else
+    {
+        out[0] = type | 27;
+        argumentBytes = 8;
+    }
+    for (int i = argumentBytes; i > 0; i--) // Big endian
+    {
+        out[i] = (uint8_t)argument;
+        argument >>= 8;
+    }
+    return argumentBytes + 1;
+}
+
+size_t trackleUtilsCborEncodeInt(uint8_t *out, int64_t value)
+{
+    // Negative values are encoded as -1 - value, that is the complement of their bits
+    return value < 0 ? trackleUtilsCborEncodeHead(out, TRACKLE_UTILS_CBOR_NEGATIVE_INT, ~(uint64_t)value)
+                     : trackleUtilsCborEncodeHead(out, TRACKLE_UTILS_CBOR_UNSIGNED_INT, (uint64_t)value);
+}
+
+size_t trackleUtilsCborEncodeFloat(uint8_t *out, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    out[0] = TRACKLE_UTILS_CBOR_FLOAT32;
+    for (int i = 4; i > 0; i--)
+    {
+        out[i] = (uint8_t)bits;
+        bits >>= 8;
+    }
+    return 5;
+}
+
+size_t trackleUtilsCborEncodeDouble(uint8_t *out, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    out[0] = TRACKLE_UTILS_CBOR_FLOAT64;
+    for (int i = 8; i > 0; i--)
+    {
+        out[i] = (uint8_t)bits;
+        bits >>= 8;
+    }
+    return 9;
+}
+
+size_t trackleUtilsVarintEncode(uint8_t *out, uint64_t value)
+{
+    size_t length = 0;
+    for (; value >= 0x80; value >>= 7)
+    {
+        out[length++] = (uint8_t)value | 0x80;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+size_t trackleUtilsBase64Encode(char *out, const uint8_t *data, size_t length)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t written = 0;
+    size_t i = 0;
+    for (; i + 3 <= length; i += 3)
+    {
+        const uint32_t triple = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | data[i + 2];
+        out[written++] = alphabet[(triple >> 18) & 0x3F];
+        out[written++] = alphabet[(triple >> 12) & 0x3F];
+        out[written++] = alphabet[(triple >> 6) & 0x3F];
+        out[written++] = alphabet[triple & 0x3F];
+    }
+    if (i < length)
+    {
+        // One or two bytes left, padded with '='
+        const uint32_t triple = ((uint32_t)data[i] << 16) | (i + 1 < length ? (uint32_t)data[i + 1] << 8 : 0);
+        out[written++] = alphabet[(triple >> 18) & 0x3F];
+        out[written++] = alphabet[(triple >> 12) & 0x3F];
+        out[written++] = i + 1 < length ? alphabet[(triple >> 6) & 0x3F] : '=';
+        out[written++] = '=';
+    }
+    out[written] = '\0';
+    return written;
+}
@@ -0,0 +1,180 @@
+#ifndef TRACKLE_UTILS_INTERNAL_H
+#define TRACKLE_UTILS_INTERNAL_H
+
+// Functions shared between the modules of the component, not part of the public API.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/time.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <trackle_utils_memory.h>
+#include <trackle_utils_retry.h>
+#include <trackle_utils_task.h>
+#include <trackle_utils_time.h>
+
+// Current time [µs], as used by the engines (see Trackle_Time_setSource).
+static inline int64_t trackleUtilsNowUs()
+{
+    return Trackle_Time_getUs();
+}
+
+// Current time [ms] on the same clock, truncated to 32 bits: it wraps, so it must only be compared as a difference.
+static inline uint32_t trackleUtilsNowMs()
+{
+    return (uint32_t)(trackleUtilsNowUs() / 1000);
+}
+
+// True if the tick count now is at or after deadline, handling the wrap of the tick count.
+static inline bool trackleUtilsIsTickReached(TickType_t now, TickType_t deadline)
+{
+    return (TickType_t)(now - deadline) < portMAX_DELAY / 2;
+}
+
+#define TRACKLE_UTILS_WALL_CLOCK_VALID_SEC 1577836800 // 2020-01-01T00:00:00Z, the wall clock is considered set after it
+
+// Current wall-clock time [ms since the epoch]. Returns false if the wall clock wasn't set yet (e.g. by SNTP).
+static inline bool trackleUtilsGetWallClockMs(uint64_t *wallMs)
+{
+    struct timeval tv;
+    if (gettimeofday(&tv, NULL) != 0 || tv.tv_sec < TRACKLE_UTILS_WALL_CLOCK_VALID_SEC)
+    {
+        return false;
+    }
+    *wallMs = (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    return true;
+}
+
+// Allocate zeroed memory for n elements of the given size, in the memory chosen for the class. Returns NULL on failure.
+void *trackleUtilsCalloc(Trackle_MemClass_t memClass, size_t n, size_t size);
+
+// Allocate zeroed memory for n elements of the given size in internal RAM, whatever the placements: for the state the
+// tasks touch at every tick. Returns NULL on failure.
+void *trackleUtilsCallocInternal(size_t n, size_t size);
+
+// Free memory allocated with trackleUtilsCalloc or trackleUtilsCallocInternal.
+void trackleUtilsFree(void *ptr);
+
+// Allocate zeroed memory from the values pool, 4-byte aligned. It's never freed. Returns NULL on failure.
+// Not thread-safe: values are allocated when properties are created.
+void *trackleUtilsPoolAlloc(size_t size);
+
+// Task started by the component, with its configuration and statistics.
+typedef struct
+{
+    TaskHandle_t handle;         // NULL until the task is started
+    Trackle_TaskConfig_t config; // Configuration the task was started with
+    Trackle_TaskStats_t stats;   // Statistics of the loops (stack high water mark is read on request)
+    portMUX_TYPE statsLock;      // Protects stats, written by the task and read by any other
+} TrackleUtilsTask_t;
+
+#define TRACKLE_UTILS_TASK_INIT {.handle = NULL, .statsLock = portMUX_INITIALIZER_UNLOCKED}
+
+// True if the task can be started with config: period at least one tick long, valid priority and core.
+bool trackleUtilsTaskIsConfigValid(const Trackle_TaskConfig_t *config);
+
+// Validate config and create the task. Returns true on success.
+bool trackleUtilsTaskStart(TrackleUtilsTask_t *task, TaskFunction_t code, const char *name, const Trackle_TaskConfig_t *config);
+
+// Times at the beginning of the work of a loop.
+typedef struct
+{
+    int64_t wallUs; // Wall-clock time [us]
+    uint32_t cpuUs; // Run-time counter of the task [us] (0 without run-time statistics)
+} TrackleUtilsLoopStart_t;
+
+// Called by the task at the beginning and at the end of the work of every loop, to keep the statistics.
+TrackleUtilsLoopStart_t trackleUtilsTaskLoopBegin();
+void trackleUtilsTaskLoopEnd(TrackleUtilsTask_t *task, TrackleUtilsLoopStart_t loopStart);
+
+// Sleep until the deadline, or until the task is notified (by xTaskNotifyGive). Returns true if woken up by a notification.
+bool trackleUtilsTaskWaitUntil(TickType_t deadline);
+
+// Copy the statistics of the task to stats. Returns false if the task wasn't started.
+bool trackleUtilsTaskGetStats(TrackleUtilsTask_t *task, Trackle_TaskStats_t *stats);
+
+// Backoff state of a publisher, shared by all the publications it makes: after a failure, no publication is attempted
+// until the delay given by the retry policy is elapsed, and the delay grows until a publication succeeds.
+typedef struct
+{
+    uint32_t consecutiveFailures; // Failures since the latest success
+    uint32_t nextAttemptMs;       // Time when the next attempt is allowed (only meaningful after a failure)
+} TrackleUtilsRetry_t;
+
+void trackleUtilsRetryReset(TrackleUtilsRetry_t *retry);
+bool trackleUtilsRetryIsDue(const TrackleUtilsRetry_t *retry, uint32_t nowMs);
+uint32_t trackleUtilsRetryGetWaitMs(const TrackleUtilsRetry_t *retry, uint32_t nowMs);
+void trackleUtilsRetryOnFailure(TrackleUtilsRetry_t *retry, const Trackle_RetryPolicy_t *policy, uint32_t nowMs);
+
+// True if a publication that was already retried the given number of times must be given up.
+bool trackleUtilsRetryIsBudgetExhausted(const Trackle_RetryPolicy_t *policy, uint32_t retries);
+
+// JSON strings. Escaping covers quotes, backslashes and control chars; the other chars, UTF-8 sequences included, are
+// copied as they are.
+
+// Length of the first length chars of src once escaped, quotes excluded.
+size_t trackleUtilsJsonEscapedLength(const char *src, size_t length);
+
+// Append the first length chars of src, escaped, to the null terminated string of bufferLength chars in buffer, that
+// can hold size chars (null char excluded). Returns false, leaving the string unchanged, if there is not enough room.
+bool trackleUtilsJsonAppendEscaped(char *buffer, size_t *bufferLength, size_t size, const char *src, size_t length);
+
+// CBOR items (RFC 8949). Encoders write to out (up to 9 bytes) and return the number of bytes written.
+
+#define TRACKLE_UTILS_CBOR_UNSIGNED_INT 0 // Major types
+#define TRACKLE_UTILS_CBOR_NEGATIVE_INT 1
+#define TRACKLE_UTILS_CBOR_BYTES 2
+#define TRACKLE_UTILS_CBOR_TEXT 3
+#define TRACKLE_UTILS_CBOR_ARRAY 4
+#define TRACKLE_UTILS_CBOR_MAP 5
+#define TRACKLE_UTILS_CBOR_TAG 6
+#define TRACKLE_UTILS_CBOR_SIMPLE 7
+
+#define TRACKLE_UTILS_CBOR_FALSE 0xF4 // Initial bytes of single byte items and of floats
+#define TRACKLE_UTILS_CBOR_TRUE 0xF5
+#define TRACKLE_UTILS_CBOR_FLOAT32 0xFA
+#define TRACKLE_UTILS_CBOR_FLOAT64 0xFB
+#define TRACKLE_UTILS_CBOR_ARRAY_INDEFINITE 0x9F
+#define TRACKLE_UTILS_CBOR_MAP_INDEFINITE 0xBF
+#define TRACKLE_UTILS_CBOR_BREAK 0xFF
+
+#define TRACKLE_UTILS_CBOR_TAG_DECIMAL_FRACTION 4 // [exponent, mantissa], value = mantissa * 10^exponent
+
+// Head of an item of the given major type, with its argument (value, length or number of items) in the fewest bytes.
+size_t trackleUtilsCborEncodeHead(uint8_t *out, uint8_t majorType, uint64_t argument);
+size_t trackleUtilsCborEncodeInt(uint8_t *out, int64_t value);
+size_t trackleUtilsCborEncodeFloat(uint8_t *out, float value);
+size_t trackleUtilsCborEncodeDouble(uint8_t *out, double value);
+
+// Compact integers, as in protobuf: zigzag maps signed values to unsigned ones so that small magnitudes stay small
+// (0, -1, 1, -2 to 0, 1, 2, 3), varint writes 7 bits per byte from the least significant, with the high bit set in all
+// the bytes but the last (up to 10 bytes).
+static inline uint64_t trackleUtilsZigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+size_t trackleUtilsVarintEncode(uint8_t *out, uint64_t value);
+
+// Write the base64 encoding (with padding) of length bytes of data to out, null terminated. Returns the number of chars
+// written, null char excluded: out must have room for 4 * ((length + 2) / 3) + 1 chars.
+size_t trackleUtilsBase64Encode(char *out, const uint8_t *data, size_t length);
+
+// Engines of properties and notifications, run either by their own task or by the shared telemetry task.
+// Prepare allocates what the engine needs and makes sure that only one task runs it; Unprepare undoes it when the
+// task can't be started; Run does the work that is due and must be called periodically by the task.
+
+bool trackleUtilsPropertiesPrepare();
+void trackleUtilsPropertiesUnprepare();
+void trackleUtilsPropertiesBegin(int64_t nowUs);
+void trackleUtilsPropertiesRun(int64_t nowUs);
+
+bool trackleUtilsNotificationsPrepare();
+void trackleUtilsNotificationsUnprepare();
+void trackleUtilsNotificationsRun();
+
+#endif
@@ -0,0 +1,150 @@
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "trackle_utils_internal.h"
+
+// Escape sequences of the chars that have a short one, every other control char is written as \u00XX
+static char getShortEscape(uint8_t c)
+{
+    switch (c)
+    {
+    case '"':
+        return '"';
+    case '\\':
+        return '\\';
+    case '\b':
+        return 'b';
+    case '\f':
+        return 'f';
+    case '\n':
+        return 'n';
+    case '\r':
+        return 'r';
+    case '\t':
+        return 't';
+    default:
+        return 0;
+    }
+}
+
+static inline bool needsEscape(uint8_t c)
+{
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+static inline size_t getEscapeLength(uint8_t c)
+{
+    return getShortEscape(c) != 0 ? 2 : 6;
+}
+
+// Word-at-a-time scan (SWAR): a word is the native register, 4 bytes on Xtensa and RISC-V.
+typedef uintptr_t Word_t;
+#define WORD_ONES ((Word_t)-1 / 0xFF) // 0x01 in every byte
+#define WORD_HIGHS (WORD_ONES * 0x80) // 0x80 in every byte
+
+// Non zero if some byte of the word is less than n (n <= 0x80). Bytes >= 0x80 (UTF-8 sequences) never match.
+static inline Word_t wordHasLess(Word_t word, uint8_t n)
+{
+    return (word - WORD_ONES * n) & ~word & WORD_HIGHS;
+}
+
+static inline Word_t wordHasByte(Word_t word, uint8_t c)
+{
+    return wordHasLess(word ^ (WORD_ONES * c), 1);
+}
+
+// Index of the first char of src, starting from the given one, that needs to be escaped, or length if none does.
+static size_t findEscape(const char *src, size_t from, size_t length)
+{
+    size_t i = from;
+#if defined(__SSE2__)
+    const __m128i quotes = _mm_set1_epi8('"');
+    const __m128i backslashes = _mm_set1_epi8('\\');
+    const __m128i maxControl = _mm_set1_epi8(0x1F);
+    for (; i + sizeof(__m128i) <= length; i += sizeof(__m128i))
+    {
+        const __m128i chunk = _mm_loadu_si128((const __m128i *)(src + i));
+        const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, maxControl), chunk); // unsigned chunk <= 0x1F
+        const __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quotes), _mm_cmpeq_epi8(chunk, backslashes));
+        if (_mm_movemask_epi8(_mm_or_si128(control, special)) != 0)
+        {
+            break; // Locate it in the scalar loop
+        }
+    }
+#endif
+    for (; i + sizeof(Word_t) <= length; i += sizeof(Word_t))
+    {
+        Word_t word;
+        memcpy(&word, src + i, sizeof(word)); // No alignment required
+        if ((wordHasLess(word, 0x20) | wordHasByte(word, '"') | wordHasByte(word, '\\')) != 0)
+        {
+            break;
+        }
+    }
+    while (i < length && !needsEscape((uint8_t)src[i]))
+    {
+        i++;
+    }
+    return i;
+}
+
+size_t trackleUtilsJsonEscapedLength(const char *src, size_t length)
+{
+    size_t escapedLength = length;
+    for (size_t i = findEscape(src, 0, length); i < length; i = findEscape(src, i + 1, length))
+    {
+        escapedLength += getEscapeLength((uint8_t)src[i]) - 1;
+    }
+    return escapedLength;
+}
+
+bool trackleUtilsJsonAppendEscaped(char *buffer, size_t *bufferLength, size_t size, const char *src, size_t length)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    size_t written = *bufferLength;
+    size_t i = 0;
+    while (i < length)
+    {
+        // Copy the clean run in bulk
+        const size_t end = findEscape(src, i, length);
+        if (end - i > size - written)
+        {
+            buffer[*bufferLength] = '\0';
+            return false;
+        }
+        memcpy(buffer + written, src + i, end - i);
+        written += end - i;
+        if (end == length)
+        {
+            break;
+        }
+
+        const uint8_t c = (uint8_t)src[end];
+        const char shortEscape = getShortEscape(c);
+        if (getEscapeLength(c) > size - written)
+        {
+            buffer[*bufferLength] = '\0';
+            return false;
+        }
+        buffer[written++] = '\\';
+        if (shortEscape != 0)
+        {
+            buffer[written++] = shortEscape;
+        }
+        else
+        {
+            memcpy(buffer + written, "u00", 3);
+            buffer[written + 3] = hexDigits[c >> 4];
+            buffer[written + 4] = hexDigits[c & 0x0F];
+            written += 5;
+        }
+        i = end + 1;
+    }
+    buffer[written] = '\0';
+    *bufferLength = written;
+    return true;
+}
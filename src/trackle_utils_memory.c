@@ -0,0 +1,115 @@
+#include <trackle_utils_memory.h>
+
+#include <string.h>
+
+#include <esp_heap_caps.h>
+
+#include "trackle_utils_internal.h"
+
+static Trackle_MemPlacement_t placements[TRACKLE_MEM_CLASS_NUM] = {
+    [TRACKLE_MEM_CLASS_DESCRIPTORS] = TRACKLE_MEM_PLACEMENT_INTERNAL,
+    [TRACKLE_MEM_CLASS_VALUES] = TRACKLE_MEM_PLACEMENT_DEFAULT,
+    [TRACKLE_MEM_CLASS_BUFFERS] = TRACKLE_MEM_PLACEMENT_INTERNAL,
+};
+
+#define POOL_ALIGNMENT 4 // Alignment of the blocks carved from the values pool
+
+static size_t poolChunkSize = TRACKLE_VALUES_POOL_CHUNK_SIZE_DEFAULT; // Size of the next chunks of the values pool
+static uint8_t *poolChunk = NULL;                                     // Chunk where blocks are being carved
+static size_t poolChunkFree = 0;                                      // Bytes left in poolChunk
+static Trackle_ValuesPoolStats_t poolStats = {0};                     // Usage statistics of the values pool
+
+bool Trackle_Memory_setPlacement(Trackle_MemClass_t memClass, Trackle_MemPlacement_t placement)
+{
+    if (memClass >= 0 && memClass < TRACKLE_MEM_CLASS_NUM && placement >= TRACKLE_MEM_PLACEMENT_DEFAULT && placement <= TRACKLE_MEM_PLACEMENT_PREFER_EXTERNAL)
+    {
+        placements[memClass] = placement;
+        return true;
+    }
+    return false;
+}
+
+Trackle_MemPlacement_t Trackle_Memory_getPlacement(Trackle_MemClass_t memClass)
+{
+    if (memClass >= 0 && memClass < TRACKLE_MEM_CLASS_NUM)
+    {
+        return placements[memClass];
+    }
+    return TRACKLE_MEM_PLACEMENT_DEFAULT;
+}
+
+void *trackleUtilsCalloc(Trackle_MemClass_t memClass, size_t n, size_t size)
+{
+    switch (Trackle_Memory_getPlacement(memClass))
+    {
+    case TRACKLE_MEM_PLACEMENT_INTERNAL:
+        return heap_caps_calloc(n, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    case TRACKLE_MEM_PLACEMENT_EXTERNAL:
+        return heap_caps_calloc(n, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    case TRACKLE_MEM_PLACEMENT_PREFER_EXTERNAL:
+    {
+        void *ptr = heap_caps_calloc(n, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        return ptr != NULL ? ptr : heap_caps_calloc(n, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    default:
+        return heap_caps_calloc(n, size, MALLOC_CAP_DEFAULT);
+    }
+}
+
+void *trackleUtilsCallocInternal(size_t n, size_t size)
+{
+    return heap_caps_calloc(n, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+void trackleUtilsFree(void *ptr)
+{
+    heap_caps_free(ptr);
+}
+
+void *trackleUtilsPoolAlloc(size_t size)
+{
+    size = (size + POOL_ALIGNMENT - 1) & ~(size_t)(POOL_ALIGNMENT - 1);
+    if (size > poolChunkFree)
+    {
+        const size_t chunkSize = size > poolChunkSize ? size : poolChunkSize;
+        uint8_t *chunk = trackleUtilsCalloc(TRACKLE_MEM_CLASS_VALUES, 1, chunkSize);
+        if (chunk == NULL)
+        {
+            poolStats.failures++;
+            return NULL;
+        }
+        poolStats.chunks++;
+        poolStats.capacity += chunkSize;
+        if (chunkSize - size >= poolChunkFree)
+        {
+            // Keep carving from the chunk with more room left
+            poolChunk = chunk;
+            poolChunkFree = chunkSize;
+        }
+        else
+        {
+            poolStats.used += size;
+            return chunk;
+        }
+    }
+    void *block = poolChunk;
+    poolChunk += size;
+    poolChunkFree -= size;
+    poolStats.used += size;
+    return block;
+}
+
+bool Trackle_Memory_setValuesPoolChunkSize(size_t chunkSize)
+{
+    if (chunkSize == 0)
+    {
+        return false;
+    }
+    poolChunkSize = chunkSize;
+    return true;
+}
+
+void Trackle_Memory_getValuesPoolStats(Trackle_ValuesPoolStats_t *stats)
+{
+    *stats = poolStats;
+}
@@ -9,13 +9,11 @@
 
 #include <trackle_esp32.h>
 
+#include "trackle_utils_internal.h"
+
 #define MESSAGE_BUFFER_LEN 1024 // Length of the buffer that holds the string of the notification while it's being built.
 
 #define TRACKLE_NOTIFICATIONS_TASK_NAME "trackle_utils_notifications"
-#define TRACKLE_NOTIFICATIONS_TASK_STACK_SIZE 8192
-#define TRACKLE_NOTIFICATIONS_TASK_PRIORITY (tskIDLE_PRIORITY + 10)
-#define TRACKLE_NOTIFICATIONS_TASK_CORE_ID 1
-#define TRACKLE_NOTIFICATIONS_TASK_PERIOD_MS 1000
 
 static const char *TAG = "trackle_utils_notifications";
 static const char *EMPTY_STRING = "";
@@ -36,10 +34,20 @@ typedef struct
     uint16_t scale;                          // Scale factor (divides new value when set)
     uint8_t numDecimals;                     // Number of decimal digits (only used if scale is set)
     uint8_t level;
+    uint32_t retries; // Number of times publishing the latest change was retried
 } Notification_t;
 
-static Notification_t notifications[TRACKLE_MAX_NOTIFICATIONS_NUM] = {0}; // Array holding the notifications created by the user.
-static int numNotificationsCreated = 0;                                   // Number of the notifications created (aka next notification ID available)
+static Notification_t *notifications = NULL; // Array holding the notifications created by the user (allocated on first notification creation).
+static int numNotificationsCreated = 0;     // Number of the notifications created (aka next notification ID available)
+
+static TrackleUtilsTask_t notificationsTask = TRACKLE_UTILS_TASK_INIT; // Task started by Trackle_Notifications_startTaskWithConfig
+static bool enginePrepared = false;                                    // The engine can be run by only one task
+
+static Trackle_RetryPolicy_t retryPolicy = TRACKLE_RETRY_POLICY_DEFAULT(); // Policy for retrying notifications that failed to be published
+static TrackleUtilsRetry_t publishRetry = {0};                              // Backoff state of the notifications publisher
+static Trackle_PublishStats_t publishStats = {0};                           // Counters of the notifications published
+
+static char *messageBuffer = NULL; // Buffer that holds the string of the notification while it's being built (allocated on task start).
 
 static bool makeMessageStringFromNotification(char *messageBuffer, int notificationIndex)
 {
@@ -70,63 +78,151 @@ static bool makeMessageStringFromNotification(char *messageBuffer, int notificat
                    valueBuffer) >= 0;
 }
 
-static void trackleNotificationsTaskCode(void *arg)
+void trackleUtilsNotificationsRun()
 {
-
-    static char messageBuffer[MESSAGE_BUFFER_LEN];
-
-    TickType_t latestWakeTime = xTaskGetTickCount();
-
-    for (;;)
+    // While disconnected nothing is attempted: changed notifications are published once connected, and no failure is counted.
+    if (!trackleConnected(trackle_s))
     {
+        return;
+    }
 
-        vTaskDelayUntil(&latestWakeTime, TRACKLE_NOTIFICATIONS_TASK_PERIOD_MS / portTICK_PERIOD_MS);
+    // For each notification ...
+    for (int aIdx = 0; aIdx < numNotificationsCreated; aIdx++)
+    {
+        const uint32_t nowMs = trackleUtilsNowMs();
 
-        // For each notification ...
-        for (int aIdx = 0; aIdx < numNotificationsCreated; aIdx++)
+        // ... if its level changed (and, after a failure, if the retry delay is elapsed) ...
+        if (notifications[aIdx].changed && trackleUtilsRetryIsDue(&publishRetry, nowMs))
         {
-            // ... if its level changed ...
-            if (notifications[aIdx].changed)
+            // ... make string representation and publish it.
+            makeMessageStringFromNotification(messageBuffer, aIdx);
+            if (notifications[aIdx].retries > 0)
+            {
+                publishStats.retries++;
+            }
+            const bool success = tracklePublishSecure(notifications[aIdx].event, messageBuffer);
+            if (success)
+            {
+                publishStats.published++;
+                trackleUtilsRetryReset(&publishRetry);
+                notifications[aIdx].changed = false;
+            }
+            else // on failure, publishing is retried after the delay given by the retry policy.
             {
-                // ... make string representation and publish it.
-                makeMessageStringFromNotification(messageBuffer, aIdx);
-                const bool success = tracklePublishSecure(notifications[aIdx].event, messageBuffer);
-                if (success) // on failure, publishing is retried at next period.
+                publishStats.failures++;
+                trackleUtilsRetryOnFailure(&publishRetry, &retryPolicy, nowMs);
+                if (trackleUtilsRetryIsBudgetExhausted(&retryPolicy, notifications[aIdx].retries))
                 {
+                    publishStats.dropped++;
                     notifications[aIdx].changed = false;
                 }
+                else
+                {
+                    notifications[aIdx].retries++;
+                }
             }
         }
     }
 }
 
+static void trackleNotificationsTaskCode(void *arg)
+{
+
+    TickType_t latestWakeTime = xTaskGetTickCount();
+
+    for (;;)
+    {
+        vTaskDelayUntil(&latestWakeTime, notificationsTask.config.periodMs / portTICK_PERIOD_MS);
+        const TrackleUtilsLoopStart_t loopStart = trackleUtilsTaskLoopBegin();
+        trackleUtilsNotificationsRun();
+        trackleUtilsTaskLoopEnd(&notificationsTask, loopStart);
+    }
+}
+
+bool trackleUtilsNotificationsPrepare()
+{
+    if (enginePrepared)
+    {
+        ESP_LOGE(TAG, "Task already started.");
+        return false;
+    }
+    if (messageBuffer == NULL)
+    {
+        messageBuffer = trackleUtilsCalloc(TRACKLE_MEM_CLASS_BUFFERS, MESSAGE_BUFFER_LEN, sizeof(char));
+        if (messageBuffer == NULL)
+        {
+            ESP_LOGE(TAG, "Error in buffer allocation.");
+            return false;
+        }
+    }
+    enginePrepared = true;
+    return true;
+}
+
+void trackleUtilsNotificationsUnprepare()
+{
+    trackleUtilsFree(messageBuffer);
+    messageBuffer = NULL;
+    enginePrepared = false;
+}
+
 bool Trackle_Notifications_startTask()
 {
+    const Trackle_TaskConfig_t config = TRACKLE_NOTIFICATIONS_TASK_CONFIG_DEFAULT();
+    return Trackle_Notifications_startTaskWithConfig(&config);
+}
 
-    ESP_LOGI(TAG, "Initializing...");
+bool Trackle_Notifications_startTaskWithConfig(const Trackle_TaskConfig_t *config)
+{
 
-    // Task creation
-    BaseType_t taskCreationRes;
+    ESP_LOGI(TAG, "Initializing...");
 
-    taskCreationRes = xTaskCreatePinnedToCore(trackleNotificationsTaskCode,
-                                              TRACKLE_NOTIFICATIONS_TASK_NAME,
-                                              TRACKLE_NOTIFICATIONS_TASK_STACK_SIZE,
-                                              NULL,
-                                              TRACKLE_NOTIFICATIONS_TASK_PRIORITY,
-                                              NULL,
-                                              TRACKLE_NOTIFICATIONS_TASK_CORE_ID);
+    if (!trackleUtilsTaskIsConfigValid(config) || !trackleUtilsNotificationsPrepare())
+    {
+        return false;
+    }
 
-    if (taskCreationRes != ESP_OK)
+    // Task creation
+    if (trackleUtilsTaskStart(&notificationsTask, trackleNotificationsTaskCode, TRACKLE_NOTIFICATIONS_TASK_NAME, config))
     {
         ESP_LOGI(TAG, "Task created successfully.");
         return true;
     }
     ESP_LOGE(TAG, "Error in task creation.");
+    trackleUtilsNotificationsUnprepare();
     return false;
 }
 
+bool Trackle_Notifications_getTaskStats(Trackle_TaskStats_t *stats)
+{
+    return trackleUtilsTaskGetStats(&notificationsTask, stats);
+}
+
+bool Trackle_Notifications_setRetryPolicy(const Trackle_RetryPolicy_t *policy)
+{
+    if (policy == NULL || policy->multiplier == 0)
+    {
+        return false;
+    }
+    retryPolicy = *policy;
+    return true;
+}
+
+void Trackle_Notifications_getPublishStats(Trackle_PublishStats_t *stats)
+{
+    *stats = publishStats;
+}
+
 Trackle_NotificationID_t Trackle_Notification_create(const char *name, const char *eventName, const char *format, uint16_t scale, uint8_t numDecimals, bool sign)
 {
+    if (notifications == NULL)
+    {
+        notifications = trackleUtilsCalloc(TRACKLE_MEM_CLASS_DESCRIPTORS, TRACKLE_MAX_NOTIFICATIONS_NUM, sizeof(Notification_t));
+        if (notifications == NULL)
+        {
+            return Trackle_NotificationID_ERROR;
+        }
+    }
     if (numNotificationsCreated < TRACKLE_MAX_NOTIFICATIONS_NUM)
     {
         const int newNotificationIndex = numNotificationsCreated;
@@ -167,6 +263,7 @@ Trackle_NotificationID_t Trackle_Notification_create(const char *name, const cha
         notifications[newNotificationIndex].numDecimals = numDecimals;
         notifications[newNotificationIndex].changed = false;
         notifications[newNotificationIndex].level = 0;
+        notifications[newNotificationIndex].retries = 0;
         numNotificationsCreated++;
         return newNotificationIndex + 1; // Convert internal notification index to notification ID by incrementing it.
     }
@@ -180,6 +277,7 @@ bool Trackle_Notification_update(Trackle_NotificationID_t notificationID, uint8_
     {
         if (notifications[notificationIndex].level != newLevel)
         {
+            notifications[notificationIndex].retries = 0;
             notifications[notificationIndex].changed = true;
             notifications[notificationIndex].value = value;
             notifications[notificationIndex].level = newLevel;
@@ -1,73 +1,306 @@
 #include <trackle_utils_properties.h>
 
+#include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
 #include <inttypes.h>
+#include <math.h>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
 #include <esp_log.h>
+#include <esp_random.h>
+#include <esp_timer.h>
+#include <nvs.h>
 
 #include <trackle_esp32.h>
 
-#define JSON_BUFFER_LEN 1024 // Length of the buffer that holds the JSON string of the properties while it's being built.
+#include "trackle_utils_internal.h"
+
+#define JSON_BUFFER_LEN 1024    // Length of the buffer that holds the JSON string of the properties while it's being built.
+#define CBOR_BUFFER_LEN ((JSON_BUFFER_LEN - 1) / 4 * 3) // Length of the buffer of the CBOR map, whose base64 encoding fits in a slot
+#define PAYLOAD_ENCODINGS_NUM 2 // Number of values of Trackle_PropsEncoding_t
+#define SERIES_BLOB_MAX_BYTES 256 // Max number of bytes of the deltas of a series in a payload
+#define LOAD_MAX_BINS 1024      // Max number of time bins over which the load of the groups is predicted
+#define PHASE_MAX_CANDIDATES 64 // Max number of phases tried for each group when spreading phases
+#define PUBLISH_SLOTS_NUM 2     // Number of payloads that can be serialized while previous ones are still being sent (async publish only).
+
+#define PROPS_BITSET_WORDS ((TRACKLE_MAX_PROPS_NUM + 31) / 32) // Number of words of a bitset with a bit for each property
 
 #define TRACKLE_PROPERTIES_TASK_NAME "trackle_utils_properties"
-#define TRACKLE_PROPERTIES_TASK_STACK_SIZE 8192
-#define TRACKLE_PROPERTIES_TASK_PRIORITY (tskIDLE_PRIORITY + 10)
-#define TRACKLE_PROPERTIES_TASK_CORE_ID 1
-#define TRACKLE_PROPERTIES_TASK_PERIOD_MS 100
+#define TRACKLE_PROPERTIES_SENDER_TASK_NAME "trackle_utils_props_sender"
 
 static const char *TAG = "trackle_utils_properties";
 static const char *EMPTY_STRING = "";
 
-// Property data structure
+// Bits of the flags of a property (see \ref PropsHot_t)
+#define PROP_FLAG_CHANGED 0x01        // True if read value is changed
+#define PROP_FLAG_RESEND 0x02        // True if the latest publication of the value failed, so it must be published again
+#define PROP_FLAG_SYNCED 0x10         // True if the value was published (or is being published) since the latest resync started
+#define PROP_FLAG_RESTORED 0x20       // True if the last published value was restored from NVS at boot
+
+// Bits of the configuration of a property (see \ref PropsHot_t)
+#define PROP_CONFIG_URGENT 0x01  // True if the property has urgent priority
+#define PROP_CONFIG_SETTLE 0x02  // True if the property is in a group published on settle
+#define PROP_CONFIG_GROUPED 0x04 // True if the property was added to at least a group
+
+// Kinds of the properties, telling where their values are and how they are serialized (see \ref PropsHot_t)
+typedef enum
+{
+    PROP_KIND_NUMBER = 0, // int32 or uint32, with scale and decimals
+    PROP_KIND_STRING,     // Values in the string buffers of PropsCold_t, their hashes in the int32 values
+    PROP_KIND_FLOAT,      // float, stored as its bits in the int32 values
+    PROP_KIND_INT64,      // int64, in WideValues_t (the int32 values hold its index there)
+    PROP_KIND_UINT64,     // uint64, in WideValues_t (the int32 values hold its index there)
+    PROP_KIND_BITFIELD,   // Up to 32 named flags, mask in the int32 values
+    PROP_KIND_ENUM,       // Index of a label, in the int32 values
+    PROP_KIND_SERIES,     // Samples in the ring of a Series_t (the int32 values hold its index there)
+} PropKind_t;
+
+// Hot state of the properties: everything the task touches at every tick, one array per field so that a scan
+// over all the properties only pulls the fields it needs through the cache.
+typedef struct
+{
+    int32_t setValue[TRACKLE_MAX_PROPS_NUM];         // Latest set value
+    int32_t lastPubValue[TRACKLE_MAX_PROPS_NUM];     // Latest published value
+    uint8_t flags[TRACKLE_MAX_PROPS_NUM];            // PROP_FLAG_* bits, written only on creation and by the task
+    uint8_t config[TRACKLE_MAX_PROPS_NUM];           // PROP_CONFIG_* bits, written only on creation and by API callers configuring the property
+    uint8_t kind[TRACKLE_MAX_PROPS_NUM];             // PropKind_t, written only on creation
+    bool disabled[TRACKLE_MAX_PROPS_NUM];            // If disabled, property is ignored from publish (written by API callers)
+    bool debouncing[TRACKLE_MAX_PROPS_NUM];          // Set to true if a value was set with debouncing (written by API callers)
+    int64_t latestSetTimeUs[TRACKLE_MAX_PROPS_NUM];  // Latest time the property was set (protected by timesLock)
+    int64_t debounceDelayUs[TRACKLE_MAX_PROPS_NUM];  // Delay to wait before setting the property to changed (protected by timesLock)
+    uint16_t txnId[TRACKLE_MAX_PROPS_NUM];           // Transaction that committed the latest value (0 if set outside transactions)
+} PropsHot_t;
+
+// Cold data of the properties: only needed when properties are created, serialized or queried.
+typedef struct
+{
+    char key[TRACKLE_MAX_PROPS_NUM][TRACKLE_MAX_PROP_NAME_LENGTH]; // Property name/key
+    uint16_t scale[TRACKLE_MAX_PROPS_NUM];                         // Scale factor (divides new value when set)
+    uint8_t numDecimals[TRACKLE_MAX_PROPS_NUM];                    // Number of decimal digits (only used if scale is set)
+    bool sign[TRACKLE_MAX_PROPS_NUM];                              // True if int32, false if uint32
+    char *lastPubStringValue[TRACKLE_MAX_PROPS_NUM];               // Latest published value of string properties (same buffer as the set value when they are equal)
+    char *setStringValue[TRACKLE_MAX_PROPS_NUM];                   // Latest set value of string properties
+    char *spareStringValue[TRACKLE_MAX_PROPS_NUM];                 // Buffer not in use while the set and the published values share theirs, NULL otherwise
+    uint16_t setStringLength[TRACKLE_MAX_PROPS_NUM];               // Length of the set value of string properties
+    uint16_t lastPubStringLength[TRACKLE_MAX_PROPS_NUM];           // Length of the published value of string properties
+    int stringValueMaxLength[TRACKLE_MAX_PROPS_NUM];               // Max length of the strings of string properties
+    uint8_t priority[TRACKLE_MAX_PROPS_NUM];                       // Trackle_PropPriority_t, order of publication during resync
+    const char *const *labels[TRACKLE_MAX_PROPS_NUM];              // Names of the flags of bitfield properties, or labels of enum properties (owned by the caller)
+    uint8_t numLabels[TRACKLE_MAX_PROPS_NUM];                      // Number of the flags of bitfield properties, or of the labels of enum properties
+    char **quotedLabels[TRACKLE_MAX_PROPS_NUM];                    // Labels of enum properties between quotes, ready to be published
+    uint8_t format[TRACKLE_MAX_PROPS_NUM];                         // Trackle_BitfieldFormat_t of bitfield properties
+} PropsCold_t;
+
+// Values of the 64-bit properties, kept apart so that 32-bit properties don't grow.
+typedef struct
+{
+    int64_t setValue[TRACKLE_MAX_WIDE_PROPS_NUM];     // Latest set value (uint64 values are stored with the same bits)
+    int64_t lastPubValue[TRACKLE_MAX_WIDE_PROPS_NUM]; // Latest published value
+} WideValues_t;
+
+// Ring of the samples of a series property, buffered and not published yet. API callers only write after the buffered
+// samples, and only the task releases them from the oldest, so the task can serialize them without holding the lock.
+// Touched at every sample and at every round (always in internal RAM).
+typedef struct
+{
+    int32_t *samples;        // Ring of capacity samples (from the values pool)
+    uint16_t capacity;       // Max number of samples buffered
+    uint8_t decimation;      // Number of samples averaged into each buffered one
+    uint16_t first;          // Position of the oldest buffered sample (written by the task, protected by valuesLock)
+    uint16_t count;          // Number of buffered samples (protected by valuesLock)
+    uint16_t sentCount;      // Number of the oldest samples in the payload being sent
+    bool inFlight;           // True while a payload with samples of the series is being sent
+    int64_t latestSampleUs;  // Time of the latest buffered sample (protected by valuesLock)
+    int64_t decimationSum;   // Sum of the samples added since the latest buffered one (protected by valuesLock)
+    uint8_t decimationCount; // Number of the samples added since the latest buffered one (protected by valuesLock)
+} Series_t;
+
+// Configuration of a series property only needed when its samples are serialized.
 typedef struct
 {
-    char key[TRACKLE_MAX_PROP_NAME_LENGTH]; // Property name/key
-    bool changed;                           // True if read value is changed
-    bool sign;                              // True if int32, false if uint32
-    int32_t lastPubValue;                   // Latest read value
-    int32_t setValue;                       // Latest set value
-    uint16_t scale;                         // Scale factor (divides new value when set)
-    bool disabled;                          // If disabled, property is ignored from publish
-    uint8_t numDecimals;                    // Number of decimal digits (only used if scale is set)
-    bool setToPublish;                      // True if added to JSON to publish
-    char *lastPubStringValue;               // String value
-    char *setStringValue;                   // If this is not NULL, property is a string property and this is its value
-    int stringValueMaxLength;               // Max length of the string contained in \ref stringValue field
-
-    // Debounce
-    bool debouncing;          // Set to true if a value was set with debouncing
-    uint32_t latestSetTimeMs; // Latest time the property was set
-    uint32_t debounceDelayMs; // Delay to wait before setting the property to changed
-
-} Prop_t;
-
-// Property group data structure
+    uint8_t format;      // Trackle_SeriesFormat_t
+    uint32_t intervalMs; // Interval between buffered samples, decimation included
+} SeriesCold_t;
+
+// Property group data structure: what the task touches at every round (always in internal RAM).
 typedef struct
 {
     bool onlyIfChanged;                                   // If true, update the properties within only if their values changed.
     Trackle_PropID_t propsIndexes[TRACKLE_MAX_PROPS_NUM]; // Indexes (different from IDs) of the properties in the group.
     int propsWithin;                                      // Number of properties in the group (number of valid elements in propsIndexes)
     uint32_t periodMs;                                    // Period of publication of the group in milliseconds
-    uint32_t latestWakeTimeMs;                            // Latest time the group's properties were published
+    int64_t nextDeadlineUs;                               // Next time the group's properties must be published, on the grid of the period
+    Trackle_PropsEncoding_t encoding;                     // Encoding of the payloads with the properties of the group
+    bool publishOnSettle;                                 // If true, properties are also published as soon as their debounce expires
+    uint32_t settleMinIntervalMs;                         // Min time between a publication of the group and one triggered by a settled property
+    int64_t latestPublishUs;                              // Latest time the group was due, on its period or on settle
 } PropGroup_t;
 
-static PropGroup_t propGroups[TRACKLE_MAX_PROPGROUPS_NUM] = {0}; // Array holding the properties groups created by the user.
-static int numPropGroupsCreated = 0;                             // Number of the property groups created (aka next property group ID available)
+// Configuration of a property group only needed when its deadlines are computed.
+typedef struct
+{
+    Trackle_PropGroupMissedPolicy_t missedPolicy; // What to do when whole periods were missed
+    bool alignToWallClock;                        // If true, deadlines are multiples of the period in wall-clock time
+    uint32_t phaseMs;                             // Offset of the deadlines from the grid of the period, to spread the publications
+} PropGroupCold_t;
+
+// Reasons a group is due at a round
+typedef enum
+{
+    GROUP_NOT_DUE = 0,
+    GROUP_DUE,     // Deadline of the period reached: all the properties (or the changed ones) are published
+    GROUP_SETTLED, // A property settled: only the changed properties are published
+} GroupDue_t;
+
+static PropGroup_t *propGroups = NULL;         // Array holding the properties groups created by the user (allocated on first group creation).
+static PropGroupCold_t *propGroupsCold = NULL; // Configuration of the deadlines of the property groups (allocated with propGroups).
+static int numPropGroupsCreated = 0;           // Number of the property groups created (aka next property group ID available)
+
+static PropsHot_t propsHot = {0};     // Hot state of the properties created by the user (always in internal RAM).
+static PropsCold_t *propsCold = NULL; // Cold data of the properties created by the user (allocated on first property creation).
+static int numPropsCreated = 0;       // Number of the properties created (aka next property ID available)
+
+static WideValues_t *wideValues = NULL;                       // Values of the 64-bit properties (allocated on first creation)
+static int numWidePropsCreated = 0;                           // Number of the 64-bit properties created
+static portMUX_TYPE valuesLock = portMUX_INITIALIZER_UNLOCKED; // Protects the values that aren't written atomically (64-bit values, bits of bitfields)
+
+static Series_t *series = NULL;         // Rings of the series properties (allocated on first creation)
+static SeriesCold_t *seriesCold = NULL; // Configuration of the series properties (allocated with series)
+static int numSeriesCreated = 0;        // Number of the series properties created
+
+// States of a publish slot. A slot is filled by the properties task, and sent either by the same task or by the sender task.
+typedef enum
+{
+    PUBLISH_SLOT_FREE = 0, // Available to the properties task for serializing a new payload
+    PUBLISH_SLOT_QUEUED,   // Payload waiting to be sent, or being sent
+    PUBLISH_SLOT_SENT,     // Payload sent, waiting for the properties task to collect the result
+    PUBLISH_SLOT_FAILED,   // Payload not sent, waiting for the properties task to collect the result
+} PublishSlotState_t;
+
+// Payload serialized by the properties task, together with what is needed to handle the result of its publication
+typedef struct
+{
+    char *buffer;                         // Serialized payload (JSON_BUFFER_LEN bytes, allocated when the slot is enabled)
+    uint32_t members[PROPS_BITSET_WORDS]; // Bitset of the indexes of the properties serialized in the payload
+    uint32_t retries;                     // Number of times sending the payload was retried
+    int dictionaryEnd;                    // If the payload is a chunk of the key dictionary, index after its last key (0 otherwise)
+    uint32_t dictionarySession;           // Session of the key dictionary the chunk belongs to
+    PublishSlotState_t state;             // Protected by slotsLock
+} PublishSlot_t;
+
+static TrackleUtilsTask_t propertiesTask = TRACKLE_UTILS_TASK_INIT; // Task started by Trackle_Props_startTaskWithConfig
+static TrackleUtilsTask_t senderTask = TRACKLE_UTILS_TASK_INIT;     // Task started by Trackle_Props_startSenderTask, NULL handle if payloads are sent by the properties task
+static bool enginePrepared = false;                                 // The engine can be run by only one task
+
+static PublishSlot_t publishSlots[PUBLISH_SLOTS_NUM] = {0};       // Slots where payloads are serialized
+static int numPublishSlots = 0;                                  // Number of slots with a buffer (1, or PUBLISH_SLOTS_NUM with the sender task)
+static QueueHandle_t sendQueue = NULL;                           // Indexes of the slots waiting to be sent, in order
+static portMUX_TYPE publishSlotsLock = portMUX_INITIALIZER_UNLOCKED; // Protects the state of the slots
+
+static Trackle_PropsResyncConfig_t resyncConfig = TRACKLE_PROPS_RESYNC_CONFIG_DEFAULT(); // How the complete publication after connection is spread
+static bool resyncActive = false;                                                       // True while not all the properties were published since the latest connection
+static int64_t resyncNextChunkUs = 0;                                                   // Time when the next chunk of unsynced properties can be published
+static bool wasConnected = false;                                                       // Connection status at the previous round
+static bool everConnected = false;                                                      // True after the first connection
+
+static portMUX_TYPE txnLock = portMUX_INITIALIZER_UNLOCKED; // Makes the values committed by a transaction visible all together (taken before valuesLock)
+static uint16_t latestTxnId = 0;                            // ID of the latest committed transaction
+
+static portMUX_TYPE timesLock = portMUX_INITIALIZER_UNLOCKED; // Protects the 64-bit times of the properties, not atomic on 32-bit cores (never held while taking other locks)
+
+static TaskHandle_t engineTaskHandle = NULL; // Task running the engine, woken up by urgent properties and by the settle timer
+static volatile bool urgentPending = false;  // Set by API callers when an urgent property is updated, cleared by the task
+
+static esp_timer_handle_t settleTimer = NULL;       // One-shot timer waking up the engine when properties of groups published on settle may have settled
+static int64_t settleTimerDeadlineUs = INT64_MAX; // Time the settle timer expires (INT64_MAX if not armed), protected by timesLock
+
+#define PERSISTENCE_VALUES_KEY "values" // NVS key of the blob with the last published values of numeric properties
+
+// Last published value of a numeric property, as stored in NVS
+typedef struct
+{
+    uint32_t keyHash; // Hash of the key of the property
+    int64_t value;    // Last published value (widened to 64 bits)
+} PersistedValue_t;
+
+static bool persistenceEnabled = false;                      // True if last published values are stored in NVS
+static nvs_handle_t persistenceHandle;                       // Handle of the NVS namespace where values are stored
+static uint32_t persistenceMinIntervalMs = 0;                // Min time between two writes to NVS
+static int64_t persistenceLatestWriteUs = 0;                 // Time of the latest write to NVS
+static bool persistenceValuesDirty = false;                  // True if a numeric value was published after the latest write
+static uint32_t persistenceStringsDirty[PROPS_BITSET_WORDS]; // Bitset of the string properties published after the latest write
+
+static Trackle_RetryPolicy_t retryPolicy = TRACKLE_RETRY_POLICY_DEFAULT(); // Policy for retrying payloads that failed to be sent
+static TrackleUtilsRetry_t sendRetry = {0};                                 // Backoff state of the sender stage
+static Trackle_PublishStats_t publishStats = {0};                           // Counters of the payloads sent by the sender stage
+
+// Token bucket, with tokens scaled by the refill period so that refilling needs no division
+typedef struct
+{
+    int64_t scaledTokens;    // Tokens available multiplied by the refill period (negative when in debt)
+    int64_t latestRefillUs;  // Latest time the bucket was refilled
+} TokenBucket_t;
+
+#define DEADLINE_TOLERANCE_US ((int64_t)portTICK_PERIOD_MS * 1000) // Earliest a deadline can be handled by a task waking up on the tick
+
+#define BUDGET_BYTES_PERIOD_US 1000000     // Refill period of the bytes budget
+#define BUDGET_PAYLOADS_PERIOD_US 60000000 // Refill period of the payloads budget
+
+static Trackle_PropsBudget_t budget = TRACKLE_PROPS_BUDGET_DEFAULT(); // Bandwidth budget of the properties
+static TokenBucket_t budgetBytes = {0};                               // Bytes that can be published
+static TokenBucket_t budgetPayloads = {0};                            // Payloads that can be published
+
+static Trackle_PropsEncoding_t propsEncoding = TRACKLE_PROPS_ENCODING_JSON; // Encoding of the urgent properties and of the resync chunks
+static uint8_t *cborBuffer = NULL;                                          // Where CBOR maps are built before being base64 encoded in a slot
 
-static Prop_t props[TRACKLE_MAX_PROPS_NUM] = {0}; // Array holding the properties created by the user.
-static int numPropsCreated = 0;                   // Number of the properties created (aka next property ID available)
+#define KEY_DICTIONARY_VERSION_KEY "_k" // Key of the version of the dictionary in the payloads that use ids
+#define PAYLOAD_WALL_TIME_KEY "_ts"      // Key of the wall-clock time of a payload [ms since epoch]
+#define PAYLOAD_BOOT_TIME_KEY "_up"      // Key of the time of a payload since boot [ms], until the wall clock is set
+#define PAYLOAD_SEQ_KEY "_seq"           // Key of the sequence number of a payload
+#define PAYLOAD_AGES_KEY "_dt"           // Key of the ages of the values in a payload [ms]
+
+static Trackle_PropsTimestamps_t timestampsMode = TRACKLE_PROPS_TIMESTAMPS_NONE; // Timing added to the payloads
+static uint32_t nextPayloadSeq = 0;                                           // Sequence number of the next payload queued
+
+static bool keyDictionaryEnabled = false; // True if payloads refer to properties by id once the dictionary is published
+static uint32_t keyDictionaryVersion = 0; // Hash of the keys of the dictionary
+static int keyDictionaryNumProps = 0;     // Number of properties the version refers to (0 until it's computed in a session)
+static int keyDictionaryPublished = 0;    // Number of keys of the dictionary published in the current session
+static int keyDictionaryQueued = 0;       // Number of keys of the dictionary queued (or published) in the current session
+static uint32_t keyDictionarySession = 0; // Incremented when the dictionary is published again, chunks of previous sessions are ignored
 
 static int32_t defaultValue = 0;   //  Default value of a new property
 static bool defaultChanged = true; // Default changed value of a property
 
 Trackle_PropGroupID_t Trackle_PropGroup_create(uint32_t periodMs, bool onlyIfChanged)
 {
+    if (propGroups == NULL)
+    {
+        propGroups = trackleUtilsCallocInternal(TRACKLE_MAX_PROPGROUPS_NUM, sizeof(PropGroup_t));
+        propGroupsCold = trackleUtilsCalloc(TRACKLE_MEM_CLASS_DESCRIPTORS, TRACKLE_MAX_PROPGROUPS_NUM, sizeof(PropGroupCold_t));
+        if (propGroups == NULL || propGroupsCold == NULL)
+        {
+            trackleUtilsFree(propGroups);
+            trackleUtilsFree(propGroupsCold);
+            propGroups = NULL;
+            propGroupsCold = NULL;
+            return Trackle_PropGroupID_ERROR;
+        }
+    }
     if (numPropGroupsCreated < TRACKLE_MAX_PROPGROUPS_NUM)
     {
         const int newPropGroupIndex = numPropGroupsCreated;
-        propGroups[newPropGroupIndex].latestWakeTimeMs = 0; // 0 is not significant here, it must be updated on task start with current time
+        propGroups[newPropGroupIndex].nextDeadlineUs = 0; // 0 is not significant here, it must be updated on task start with current time
+        propGroupsCold[newPropGroupIndex].missedPolicy = TRACKLE_PROPGROUP_MISSED_FIRE_ONCE;
+        propGroupsCold[newPropGroupIndex].alignToWallClock = false;
+        propGroupsCold[newPropGroupIndex].phaseMs = 0;
+        propGroups[newPropGroupIndex].encoding = TRACKLE_PROPS_ENCODING_JSON;
+        propGroups[newPropGroupIndex].publishOnSettle = false;
+        propGroups[newPropGroupIndex].settleMinIntervalMs = 0;
+        propGroups[newPropGroupIndex].latestPublishUs = 0;
         propGroups[newPropGroupIndex].onlyIfChanged = onlyIfChanged;
         propGroups[newPropGroupIndex].propsWithin = 0;
         propGroups[newPropGroupIndex].periodMs = periodMs;
@@ -81,7 +314,7 @@ bool Trackle_PropGroup_addProp(Trackle_PropID_t propId, Trackle_PropGroupID_t pr
 {
     const int propIndex = propId - 1;           // Convert property ID to internal property index by decrementing it.
     const int propGroupIndex = propGroupId - 1; // Convert property group ID to internal property group index by decrementing it.
-    if (propGroupIndex >= 0 && propGroupIndex < numPropGroupsCreated && propIndex < numPropsCreated && propIndex >= 0 && propGroups[propGroupId].propsWithin < TRACKLE_MAX_PROPS_NUM - 1)
+    if (propGroupIndex >= 0 && propGroupIndex < numPropGroupsCreated && propIndex < numPropsCreated && propIndex >= 0 && propGroups[propGroupIndex].propsWithin < TRACKLE_MAX_PROPS_NUM - 1)
     {
         const int propsWithin = propGroups[propGroupIndex].propsWithin;
         for (int i = 0; i < propsWithin; i++)
@@ -93,363 +326,2876 @@ bool Trackle_PropGroup_addProp(Trackle_PropID_t propId, Trackle_PropGroupID_t pr
         }
         propGroups[propGroupIndex].propsIndexes[propsWithin] = propIndex;
         propGroups[propGroupIndex].propsWithin++;
+        propsHot.config[propIndex] |= propGroups[propGroupIndex].publishOnSettle ? PROP_CONFIG_GROUPED | PROP_CONFIG_SETTLE : PROP_CONFIG_GROUPED;
         return true;
     }
     return false;
 }
 
-static char *lastCharPtr(char *s)
+bool Trackle_PropGroup_setMissedPolicy(Trackle_PropGroupID_t propGroupId, Trackle_PropGroupMissedPolicy_t policy)
+{
+    const int propGroupIndex = propGroupId - 1;
+    if (propGroupIndex < 0 || propGroupIndex >= numPropGroupsCreated || (policy != TRACKLE_PROPGROUP_MISSED_FIRE_ONCE && policy != TRACKLE_PROPGROUP_MISSED_SKIP))
+    {
+        return false;
+    }
+    propGroupsCold[propGroupIndex].missedPolicy = policy;
+    return true;
+}
+
+bool Trackle_PropGroup_setWallClockAlignment(Trackle_PropGroupID_t propGroupId, bool align)
 {
-    return &(s[strlen(s)]);
+    const int propGroupIndex = propGroupId - 1;
+    if (propGroupIndex < 0 || propGroupIndex >= numPropGroupsCreated)
+    {
+        return false;
+    }
+    propGroupsCold[propGroupIndex].alignToWallClock = align;
+    return true;
 }
 
-static void appendPropertyToJsonString(char *jsonBuffer, int propIndex)
+static void settleTimerCallback(void *arg)
 {
-    char *jsonBufferTail = lastCharPtr(jsonBuffer);
-    if (strlen(jsonBuffer) > 1)
+    if (engineTaskHandle != NULL)
     {
-        jsonBufferTail += sprintf(jsonBufferTail, ",");
+        xTaskNotifyGive(engineTaskHandle);
     }
-    if (props[propIndex].setStringValue != NULL)
-    { // string
-        jsonBufferTail += sprintf(jsonBufferTail, "\"%s\":\"%s\"", props[propIndex].key, props[propIndex].setStringValue);
+}
+
+bool Trackle_PropGroup_setPublishOnSettle(Trackle_PropGroupID_t propGroupId, bool enable, uint32_t minIntervalMs)
+{
+    const int propGroupIndex = propGroupId - 1;
+    if (propGroupIndex < 0 || propGroupIndex >= numPropGroupsCreated)
+    {
+        return false;
     }
-    else if (props[propIndex].scale == 1)
-    { // integer
-        if (props[propIndex].sign)
-        { // uint, remove sign
-            jsonBufferTail += sprintf(jsonBufferTail, "\"%s\":%" PRIu32, props[propIndex].key, (uint32_t)props[propIndex].setValue);
-        }
-        else
+    if (enable && settleTimer == NULL)
+    {
+        const esp_timer_create_args_t timerArgs = {.callback = settleTimerCallback, .name = "trackle_settle"};
+        if (esp_timer_create(&timerArgs, &settleTimer) != ESP_OK)
         {
-            jsonBufferTail += sprintf(jsonBufferTail, "\"%s\":%" PRIi32, props[propIndex].key, props[propIndex].setValue);
+            settleTimer = NULL;
+            return false;
         }
     }
-    else
-    { // double
-        char strFormat[20];
-        sprintf(strFormat, "\"%%s\":%%.%df", (int)(props[propIndex].numDecimals));
-        jsonBufferTail += sprintf(jsonBufferTail, strFormat, props[propIndex].key, ((double)props[propIndex].setValue) / props[propIndex].scale);
+    propGroups[propGroupIndex].publishOnSettle = enable;
+    propGroups[propGroupIndex].settleMinIntervalMs = minIntervalMs;
+
+    // A property is published on settle if any of its groups is
+    for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+    {
+        propsHot.config[pIdx] &= ~PROP_CONFIG_SETTLE;
+    }
+    for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
+    {
+        for (int i = 0; propGroups[pgIdx].publishOnSettle && i < propGroups[pgIdx].propsWithin; i++)
+        {
+            propsHot.config[propGroups[pgIdx].propsIndexes[i]] |= PROP_CONFIG_SETTLE;
+        }
     }
+    return true;
 }
 
-static bool isSetValueEqualToLastSent(int propIndex)
+// Allocate the buffer needed by the encoding, if any.
+static bool enableEncoding(Trackle_PropsEncoding_t encoding)
 {
-    if (props[propIndex].setStringValue != NULL)
+    if (encoding == TRACKLE_PROPS_ENCODING_CBOR_BASE64 && cborBuffer == NULL)
     {
-        // This is a string-property
-        return strcmp(props[propIndex].setStringValue, props[propIndex].lastPubStringValue) == 0;
+        cborBuffer = trackleUtilsCalloc(TRACKLE_MEM_CLASS_BUFFERS, CBOR_BUFFER_LEN, sizeof(uint8_t));
+        return cborBuffer != NULL;
     }
-    return props[propIndex].setValue == props[propIndex].lastPubValue;
+    return encoding == TRACKLE_PROPS_ENCODING_JSON || encoding == TRACKLE_PROPS_ENCODING_CBOR_BASE64;
 }
 
-static void updateLastSentToSetValue(int propIndex)
+bool Trackle_PropGroup_setEncoding(Trackle_PropGroupID_t propGroupId, Trackle_PropsEncoding_t encoding)
 {
-    if (props[propIndex].setStringValue != NULL)
-        strcpy(props[propIndex].lastPubStringValue, props[propIndex].setStringValue);
-    else
-        props[propIndex].lastPubValue = props[propIndex].setValue;
+    const int propGroupIndex = propGroupId - 1;
+    if (propGroupIndex < 0 || propGroupIndex >= numPropGroupsCreated || !enableEncoding(encoding))
+    {
+        return false;
+    }
+    propGroups[propGroupIndex].encoding = encoding;
+    return true;
 }
 
-static bool isMsElapsed(uint32_t now, uint32_t start, uint32_t delay)
+bool Trackle_Props_setTimestamps(Trackle_PropsTimestamps_t mode)
 {
-    if (now < start)
-        return (now + UINT32_MAX - start + 1) >= delay;
-    return now - start >= delay;
+    if (mode != TRACKLE_PROPS_TIMESTAMPS_NONE && mode != TRACKLE_PROPS_TIMESTAMPS_PAYLOAD && mode != TRACKLE_PROPS_TIMESTAMPS_PROPERTY)
+    {
+        return false;
+    }
+    timestampsMode = mode;
+    return true;
 }
 
-static void tracklePropertiesTaskCode(void *arg)
+void Trackle_Props_enableKeyDictionary(bool enable)
 {
+    keyDictionaryEnabled = enable;
+}
 
-    static char jsonBuffer[JSON_BUFFER_LEN];
-    jsonBuffer[0] = '\0';
-
-    TickType_t latestWakeTime = xTaskGetTickCount();
-    bool first_run = true;
-
-    // Consider this instant as 0 in the time of the properties
-    for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
+bool Trackle_Props_setEncoding(Trackle_PropsEncoding_t encoding)
+{
+    if (!enableEncoding(encoding))
     {
-        propGroups[pgIdx].latestWakeTimeMs = latestWakeTime * portTICK_PERIOD_MS;
+        return false;
     }
+    propsEncoding = encoding;
+    return true;
+}
 
-    for (;;)
-    {
-        bool propsToPublish = false;
-
-        vTaskDelayUntil(&latestWakeTime, TRACKLE_PROPERTIES_TASK_PERIOD_MS / portTICK_PERIOD_MS);
-        const uint32_t nowMs = xTaskGetTickCount() * portTICK_PERIOD_MS;
-
-        if (trackleConnected(trackle_s))
-        {
-            // For each group...
-            for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
-            {
-
-                const int propsWithin = propGroups[pgIdx].propsWithin;
-                const bool onlyIfChanged = propGroups[pgIdx].onlyIfChanged;
+typedef struct PayloadSerializer PayloadSerializer_t;
 
-                // ... if its period is elapsed ...
-                if (isMsElapsed(nowMs, propGroups[pgIdx].latestWakeTimeMs, propGroups[pgIdx].periodMs) || first_run)
-                {
+// Bounded writer of the payload of a publish slot
+typedef struct
+{
+    char *buffer;                          // Buffer of the slot (JSON), or cborBuffer (CBOR)
+    size_t length;                         // Length of the payload in buffer
+    size_t size;                           // Max number of chars that can be written in buffer, null char excluded
+    const PayloadSerializer_t *serializer; // Serializer of the encoding of the payload
+    bool useKeyIds;                        // If true, properties are written with their ids in the key dictionary
+    int64_t startUs;                       // Time the payload was started, ages of the values refer to it
+    uint16_t numAges;                      // Number of valid elements in ages
+    uint32_t ages[TRACKLE_MAX_PROPS_NUM];  // Ages of the values of the properties in the payload, in order (TRACKLE_PROPS_TIMESTAMPS_PROPERTY)
+} PayloadWriter_t;
 
-                    propGroups[pgIdx].latestWakeTimeMs = nowMs;
+// Serializer of the payloads of an encoding. Properties are appended to a map opened by begin; end closes it and writes
+// the text to be published to the buffer of the slot.
+struct PayloadSerializer
+{
+    size_t size;                                                               // Max payload length, room for closing the map excluded
+    size_t agesLength;                                                         // Room taken by the array of ages, without elements
+    size_t ageLength;                                                          // Max room taken by an element of the array of ages
+    void (*begin)(PayloadWriter_t *writer);                                    // Open the map
+    bool (*appendProp)(PayloadWriter_t *writer, int propIndex, int64_t value); // Leaves the payload unchanged on failure
+    size_t (*end)(PayloadWriter_t *writer, char *slotBuffer);                  // Returns the length of the text to be published
+};
 
-                    // ... for each property in the group ...
-                    for (int i = 0; i < propsWithin; i++)
-                    {
-                        const int propIdx = propGroups[pgIdx].propsIndexes[i];
-
-                        if (props[propIdx].debouncing && isMsElapsed(nowMs, props[propIdx].latestSetTimeMs, props[propIdx].debounceDelayMs))
-                        {
-                            props[propIdx].debouncing = false;
-                            props[propIdx].changed = true;
-                        }
-
-                        // ... if it's changed or it must be published anyway ...
-                        if (!props[propIdx].disabled && ((props[propIdx].changed && !isSetValueEqualToLastSent(propIdx)) || !onlyIfChanged || first_run))
-                        {
-                            // ... add it to JSON string to publish.
-                            if (!propsToPublish)
-                            {
-                                propsToPublish = true;
-                                strcat(jsonBuffer, "{");
-                            }
-                            appendPropertyToJsonString(jsonBuffer, propIdx);
-                            props[propIdx].setToPublish = true;
-                            updateLastSentToSetValue(propIdx);
-                        }
-                    }
-                }
-            }
+static bool writerPrintf(PayloadWriter_t *writer, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const size_t room = writer->length < writer->size ? writer->size - writer->length : 0;
+    const int written = vsnprintf(writer->buffer + writer->length, room + 1, format, args);
+    va_end(args);
+    if (written < 0 || (size_t)written > room)
+    {
+        writer->buffer[writer->length] = '\0';
+        return false;
+    }
+    writer->length += written;
+    return true;
+}
 
-            // If there is at least a property in the JSON string to publish, publish it.
-            if (propsToPublish)
-            {
-                strcat(jsonBuffer, "}");
-                bool publishedSuccessfully = trackleSyncStateSecure(jsonBuffer);
-                if (publishedSuccessfully)
-                {
-                    for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
-                    {
-                        if (props[pIdx].setToPublish)
-                        {
-                            props[pIdx].changed = false;
-                        }
-                    }
-                    first_run = false;
-                }
-                for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
-                {
-                    props[pIdx].setToPublish = false;
-                }
-                jsonBuffer[0] = '\0';
-            }
-        }
+static bool writerWrite(PayloadWriter_t *writer, const void *data, size_t length)
+{
+    if (writer->length > writer->size || length > writer->size - writer->length)
+    {
+        return false;
     }
+    memcpy(writer->buffer + writer->length, data, length);
+    writer->length += length;
+    return true;
 }
 
-bool Trackle_Props_startTask()
+static float floatFromBits(int32_t bits)
 {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
 
-    ESP_LOGI(TAG, "Initializing...");
+static int32_t floatToBits(float value)
+{
+    int32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
 
-    // Task creation
-    BaseType_t taskCreationRes;
+// Append str, escaped and between quotes. On failure (not enough room) the payload is left unchanged.
+static bool writerAppendJsonString(PayloadWriter_t *writer, const char *str, size_t length)
+{
+    const size_t initialLength = writer->length;
+    if (writerPrintf(writer, "\"") && trackleUtilsJsonAppendEscaped(writer->buffer, &writer->length, writer->size, str, length) &&
+        writerPrintf(writer, "\""))
+    {
+        return true;
+    }
+    writer->length = initialLength;
+    writer->buffer[initialLength] = '\0';
+    return false;
+}
 
-    taskCreationRes = xTaskCreatePinnedToCore(tracklePropertiesTaskCode,
-                                              TRACKLE_PROPERTIES_TASK_NAME,
-                                              TRACKLE_PROPERTIES_TASK_STACK_SIZE,
-                                              NULL,
-                                              TRACKLE_PROPERTIES_TASK_PRIORITY,
-                                              NULL,
-                                              TRACKLE_PROPERTIES_TASK_CORE_ID);
+// Write the flags of a bitfield property as an object of named booleans.
+static bool appendBitfieldFlags(PayloadWriter_t *writer, int propIndex, uint32_t mask)
+{
+    bool success = writerPrintf(writer, "{");
+    for (int bit = 0; bit < propsCold->numLabels[propIndex] && success; bit++)
+    {
+        const char *label = propsCold->labels[propIndex][bit];
+        success = (bit == 0 || writerPrintf(writer, ",")) && writerAppendJsonString(writer, label, strlen(label)) &&
+                  writerPrintf(writer, ":%s", (mask >> bit) & 1 ? "true" : "false");
+    }
+    return success && writerPrintf(writer, "}");
+}
 
-    if (taskCreationRes == pdTRUE)
+// Time of the oldest buffered sample (count and latestSampleUs read together) [ms]: wall-clock time if the wall clock
+// is set (returns true), time of the engines otherwise.
+static bool getSeriesStartMs(const SeriesCold_t *config, uint16_t count, int64_t latestSampleUs, uint64_t *startMs)
+{
+    const int64_t firstSampleUs = latestSampleUs - (int64_t)(count - 1) * config->intervalMs * 1000;
+    uint64_t wallMs;
+    if (trackleUtilsGetWallClockMs(&wallMs))
     {
-        ESP_LOGI(TAG, "Task created successfully.");
+        *startMs = wallMs - (trackleUtilsNowUs() - firstSampleUs) / 1000;
         return true;
     }
-    ESP_LOGE(TAG, "Error in task creation.");
+    *startMs = firstSampleUs / 1000;
     return false;
 }
 
-int Trackle_Props_getNumber()
+static uint16_t nextSeriesPosition(const Series_t *ring, uint16_t position)
 {
-    return numPropsCreated;
+    return position + 1 < ring->capacity ? position + 1 : 0;
 }
 
-Trackle_PropID_t Trackle_Prop_create(const char *name, uint16_t scale, uint8_t numDecimals, bool sign)
+// Encode the oldest of count buffered samples as zigzag varints of the first one and of the differences between
+// consecutive ones, in at most maxLength bytes. Returns the number of bytes; numEncoded is set to the number of samples.
+static size_t encodeSeriesDeltas(const Series_t *ring, uint16_t count, uint8_t *out, size_t maxLength, uint16_t *numEncoded)
 {
-    if (numPropsCreated < TRACKLE_MAX_PROPS_NUM)
+    size_t length = 0;
+    int32_t previous = 0;
+    uint16_t position = ring->first;
+    uint16_t n = 0;
+    for (; n < count; n++, position = nextSeriesPosition(ring, position))
     {
-        const int newPropIndex = numPropsCreated;
-        for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
-        {
-            if (strcmp(name, props[pIdx].key) == 0)
-            {
-                return Trackle_PropID_ERROR;
-            }
-        }
-        if (strlen(name) < TRACKLE_MAX_PROP_NAME_LENGTH)
-        {
-            strcpy(props[newPropIndex].key, name);
-        }
-        else
+        uint8_t varint[10];
+        const int32_t sample = ring->samples[position];
+        const size_t varintLength = trackleUtilsVarintEncode(varint, trackleUtilsZigzag((int64_t)sample - previous));
+        if (length + varintLength > maxLength)
         {
-            return Trackle_PropID_ERROR;
+            break;
         }
-        props[newPropIndex].lastPubValue = defaultValue;
-        props[newPropIndex].setValue = defaultValue;
-        props[newPropIndex].scale = scale;
-        props[newPropIndex].sign = sign;
-        props[newPropIndex].numDecimals = numDecimals;
-        props[newPropIndex].disabled = false;
-        props[newPropIndex].changed = defaultChanged;
-        props[newPropIndex].setToPublish = false;
-        props[newPropIndex].lastPubStringValue = NULL;
-        props[newPropIndex].setStringValue = NULL;
-        props[newPropIndex].stringValueMaxLength = 0;
-        props[newPropIndex].debouncing = false;
-        props[newPropIndex].latestSetTimeMs = 0;
-        props[newPropIndex].debounceDelayMs = 0;
-        numPropsCreated++;
-        return newPropIndex + 1; // Convert internal property index to property ID by incrementing it.
-    }
-    return Trackle_PropID_ERROR;
+        memcpy(out + length, varint, varintLength);
+        length += varintLength;
+        previous = sample;
+    }
+    *numEncoded = n;
+    return length;
 }
 
-Trackle_PropID_t Trackle_Prop_createString(const char *name, int maxLength)
+// Take the state of the ring needed to serialize its samples. Returns the number of buffered samples.
+static uint16_t readSeriesCount(const Series_t *ring, int64_t *latestSampleUs)
+{
+    portENTER_CRITICAL(&valuesLock);
+    const uint16_t count = ring->count;
+    *latestSampleUs = ring->latestSampleUs;
+    portEXIT_CRITICAL(&valuesLock);
+    return count;
+}
+
+// Append the samples of the series not published yet, as many as fit (at least one), and remember where the payload
+// ends. On failure the payload is left unchanged.
+static bool appendSeriesToJsonString(PayloadWriter_t *writer, int propIndex)
 {
-    if (numPropsCreated < TRACKLE_MAX_PROPS_NUM)
+    Series_t *ring = &series[propsHot.setValue[propIndex]];
+    const SeriesCold_t *config = &seriesCold[propsHot.setValue[propIndex]];
+    const size_t initialLength = writer->length;
+    const size_t size = writer->size;
+    int64_t latestSampleUs;
+    const uint16_t count = readSeriesCount(ring, &latestSampleUs);
+    uint64_t startMs;
+    const bool wallClock = getSeriesStartMs(config, count, latestSampleUs, &startMs);
+    uint16_t n = 0;
+
+    if (writer->length > writer->size || writer->size - writer->length < 2)
     {
-        const int newPropIndex = numPropsCreated;
-        for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+        return false;
+    }
+    writer->size -= 2; // Room for closing the array (or the string) and the object
+    bool success = writerPrintf(writer, "{\"%c\":%" PRIu64 ",\"i\":%" PRIu32 ",", wallClock ? 't' : 'u', startMs, config->intervalMs);
+    if (config->format == TRACKLE_SERIES_FORMAT_ARRAY)
+    {
+        success = success && writerPrintf(writer, "\"v\":[");
+        for (uint16_t position = ring->first; success && n < count; n++, position = nextSeriesPosition(ring, position))
         {
-            if (strcmp(name, props[pIdx].key) == 0)
+            if (!writerPrintf(writer, n == 0 ? "%" PRIi32 : ",%" PRIi32, ring->samples[position]))
             {
-                return Trackle_PropID_ERROR;
+                break;
             }
         }
-        if (strlen(name) < TRACKLE_MAX_PROP_NAME_LENGTH)
-        {
-            strcpy(props[newPropIndex].key, name);
-        }
-        else
+        writer->size = size;
+        success = success && n > 0 && writerPrintf(writer, "]}");
+    }
+    else
+    {
+        success = success && writerPrintf(writer, "\"d\":\"");
+        writer->size = size;
+        if (success)
         {
-            return Trackle_PropID_ERROR;
+            uint8_t deltas[SERIES_BLOB_MAX_BYTES];
+            const size_t room = (writer->size - writer->length - 2) / 4 * 3; // Bytes whose base64 fits, before the closing quote and brace
+            const size_t length = encodeSeriesDeltas(ring, count, deltas, room < sizeof(deltas) ? room : sizeof(deltas), &n);
+            writer->length += trackleUtilsBase64Encode(writer->buffer + writer->length, deltas, length);
+            success = n > 0 && writerPrintf(writer, "\"}");
         }
-        props[newPropIndex].lastPubValue = defaultValue;
-        props[newPropIndex].setValue = defaultValue;
-        props[newPropIndex].scale = 1;
-        props[newPropIndex].sign = 0;
-        props[newPropIndex].numDecimals = 0;
-        props[newPropIndex].disabled = false;
-        props[newPropIndex].changed = defaultChanged;
-        props[newPropIndex].setToPublish = false;
-        props[newPropIndex].lastPubStringValue = malloc(maxLength * sizeof(char) + 1); // +1 for null character
-        if (props[newPropIndex].lastPubStringValue == NULL)
-            return Trackle_PropID_ERROR;
-        props[newPropIndex].lastPubStringValue[0] = '\0';
-        props[newPropIndex].setStringValue = malloc(maxLength * sizeof(char) + 1); // +1 for null character
-        if (props[newPropIndex].setStringValue == NULL)
-            return Trackle_PropID_ERROR;
-        props[newPropIndex].setStringValue[0] = '\0';
-        props[newPropIndex].stringValueMaxLength = maxLength;
-        props[newPropIndex].debouncing = false;
-        props[newPropIndex].latestSetTimeMs = 0;
-        props[newPropIndex].debounceDelayMs = 0;
-        numPropsCreated++;
-        return newPropIndex + 1; // Convert internal property index to property ID by incrementing it.
     }
-    return Trackle_PropID_ERROR;
+
+    if (!success)
+    {
+        writer->length = initialLength;
+        writer->buffer[initialLength] = '\0';
+        return false;
+    }
+    ring->sentCount = n;
+    ring->inFlight = true;
+    return true;
 }
 
-bool Trackle_Prop_update(Trackle_PropID_t propID, int newValue)
+// Append the property to the JSON object being written, with the given value (strings are taken from the published
+// value, widened to 64 bits for the others). On failure (not enough room) the payload is left unchanged.
+static bool appendPropertyToJsonString(PayloadWriter_t *writer, int propIndex, int64_t value)
 {
-    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
-    if (propIndex >= 0 && propIndex < numPropsCreated)
+    const size_t initialLength = writer->length;
+    const char *key = propsCold->key[propIndex];
+    bool success = (writer->length <= 1 || writerPrintf(writer, ",")) &&
+                   (writer->useKeyIds ? writerPrintf(writer, "\"%d\"", propIndex) : writerAppendJsonString(writer, key, strlen(key))) &&
+                   writerPrintf(writer, ":");
+    if (success)
     {
-        if (props[propIndex].setValue != newValue)
+        switch (propsHot.kind[propIndex])
         {
-            ESP_LOGD(TAG, "PROP CHANGED ---- %s: old: %" PRIi32 ", new: %d", props[propIndex].key, props[propIndex].setValue, newValue);
-            props[propIndex].debouncing = true;
-            props[propIndex].latestSetTimeMs = xTaskGetTickCount() * portTICK_PERIOD_MS;
-            props[propIndex].setValue = newValue;
-            return true;
+        case PROP_KIND_STRING:
+            success = writerAppendJsonString(writer, propsCold->lastPubStringValue[propIndex], propsCold->lastPubStringLength[propIndex]);
+            break;
+        case PROP_KIND_FLOAT:
+        {
+            const float floatValue = floatFromBits((int32_t)value);
+            if (isfinite(floatValue))
+                success = writerPrintf(writer, "%.*f", (int)(propsCold->numDecimals[propIndex]), (double)floatValue);
+            else
+                success = writerPrintf(writer, "null"); // JSON has no NaN nor infinity
+            break;
+        }
+        case PROP_KIND_INT64:
+            success = writerPrintf(writer, "%" PRIi64, value);
+            break;
+        case PROP_KIND_UINT64:
+            success = writerPrintf(writer, "%" PRIu64, (uint64_t)value);
+            break;
+        case PROP_KIND_ENUM:
+            success = writerPrintf(writer, "%s", propsCold->quotedLabels[propIndex][value]);
+            break;
+        case PROP_KIND_SERIES:
+            success = appendSeriesToJsonString(writer, propIndex);
+            break;
+        case PROP_KIND_BITFIELD:
+            if (propsCold->format[propIndex] == TRACKLE_BITFIELD_FORMAT_NAMED)
+                success = appendBitfieldFlags(writer, propIndex, (uint32_t)value);
+            else
+                success = writerPrintf(writer, "%" PRIu32, (uint32_t)value);
+            break;
+        default:
+            if (propsCold->scale[propIndex] == 1)
+            { // integer
+                if (propsCold->sign[propIndex])
+                { // uint, remove sign
+                    success = writerPrintf(writer, "%" PRIu32, (uint32_t)value);
+                }
+                else
+                {
+                    success = writerPrintf(writer, "%" PRIi32, (int32_t)value);
+                }
+            }
+            else
+            { // double
+                success = writerPrintf(writer, "%.*f", (int)(propsCold->numDecimals[propIndex]), ((double)(int32_t)value) / propsCold->scale[propIndex]);
+            }
+            break;
         }
     }
+    if (!success)
+    {
+        writer->length = initialLength;
+        writer->buffer[initialLength] = '\0';
+    }
+    return success;
+}
+
+// Append str as a CBOR text string. On failure (not enough room) the payload is left unchanged.
+static bool writerAppendCborText(PayloadWriter_t *writer, const char *str, size_t length)
+{
+    const size_t initialLength = writer->length;
+    uint8_t head[9];
+    if (writerWrite(writer, head, trackleUtilsCborEncodeHead(head, TRACKLE_UTILS_CBOR_TEXT, length)) && writerWrite(writer, str, length))
+    {
+        return true;
+    }
+    writer->length = initialLength;
     return false;
 }
 
-bool Trackle_Prop_updateString(Trackle_PropID_t propID, const char *newValue)
+// Append the samples of the series like appendSeriesToJsonString, as a map with an array of integers or a byte string.
+static bool appendSeriesToCbor(PayloadWriter_t *writer, int propIndex)
 {
-    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
-    if (propIndex >= 0 && propIndex < numPropsCreated)
+    Series_t *ring = &series[propsHot.setValue[propIndex]];
+    const SeriesCold_t *config = &seriesCold[propsHot.setValue[propIndex]];
+    const size_t initialLength = writer->length;
+    int64_t latestSampleUs;
+    const uint16_t count = readSeriesCount(ring, &latestSampleUs);
+    uint64_t startMs;
+    const bool wallClock = getSeriesStartMs(config, count, latestSampleUs, &startMs);
+    uint16_t n = 0;
+    uint8_t item[9];
+
+    bool success = writerWrite(writer, item, trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_MAP, 3)) &&
+                   writerAppendCborText(writer, wallClock ? "t" : "u", 1) &&
+                   writerWrite(writer, item, trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_UNSIGNED_INT, startMs)) &&
+                   writerAppendCborText(writer, "i", 1) &&
+                   writerWrite(writer, item, trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_UNSIGNED_INT, config->intervalMs));
+    if (config->format == TRACKLE_SERIES_FORMAT_ARRAY)
     {
-        if (props[propIndex].setStringValue != NULL && newValue != NULL && strcmp(props[propIndex].setStringValue, newValue) != 0)
+        item[0] = TRACKLE_UTILS_CBOR_ARRAY_INDEFINITE;
+        success = success && writerAppendCborText(writer, "v", 1) && writerWrite(writer, item, 1) && writer->length < writer->size;
+        writer->size--; // Room for the break, checked above
+        for (uint16_t position = ring->first; success && n < count; n++, position = nextSeriesPosition(ring, position))
         {
-            ESP_LOGD(TAG, "PROP CHANGED ---- %s: old: %s, new: %s", props[propIndex].key, props[propIndex].setStringValue, newValue);
-            props[propIndex].debouncing = true;
-            props[propIndex].latestSetTimeMs = xTaskGetTickCount() * portTICK_PERIOD_MS;
-            strncpy(props[propIndex].setStringValue, newValue, props[propIndex].stringValueMaxLength);
-            props[propIndex].setStringValue[props[propIndex].stringValueMaxLength] = '\0';
-            return true;
+            if (!writerWrite(writer, item, trackleUtilsCborEncodeInt(item, ring->samples[position])))
+            {
+                break;
+            }
         }
+        writer->size++;
+        item[0] = TRACKLE_UTILS_CBOR_BREAK;
+        success = success && n > 0 && writerWrite(writer, item, 1);
     }
-    return false;
+    else if (success && writerAppendCborText(writer, "d", 1))
+    {
+        uint8_t deltas[SERIES_BLOB_MAX_BYTES];
+        const size_t room = writer->size - writer->length;
+        const size_t maxLength = room > 3 ? room - 3 : 0; // Room for the head of the byte string
+        const size_t length = encodeSeriesDeltas(ring, count, deltas, maxLength < sizeof(deltas) ? maxLength : sizeof(deltas), &n);
+        success = n > 0 && writerWrite(writer, item, trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_BYTES, length)) &&
+                  writerWrite(writer, deltas, length);
+    }
+    else
+    {
+        success = false;
+    }
+
+    if (!success)
+    {
+        writer->length = initialLength;
+        return false;
+    }
+    ring->sentCount = n;
+    ring->inFlight = true;
+    return true;
 }
 
-bool Trackle_Prop_setDisabled(Trackle_PropID_t propID, bool isDisabled)
+// Exponent of the scale if it's a power of 10, -1 otherwise.
+static int getDecimalExponent(uint16_t scale)
 {
-    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
-    if (propIndex >= 0 && propIndex < numPropsCreated)
+    int exponent = 0;
+    for (; scale % 10 == 0; scale /= 10)
     {
-        props[propIndex].disabled = isDisabled;
-        return true;
+        exponent++;
     }
-    return false;
+    return scale == 1 ? exponent : -1;
 }
 
-bool Trackle_Prop_setDebounceDelay(Trackle_PropID_t propID, uint32_t debounceDelayMs)
+// Append the property to the CBOR map being written, like appendPropertyToJsonString. Integers keep their binary form:
+// scaled numbers are decimal fractions (tag 4) of their integer value, unless the scale isn't a power of 10.
+static bool appendPropertyToCbor(PayloadWriter_t *writer, int propIndex, int64_t value)
 {
-    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
-    if (propIndex >= 0 && propIndex < numPropsCreated)
+    const size_t initialLength = writer->length;
+    const char *key = propsCold->key[propIndex];
+    uint8_t item[9];
+    bool success = writer->useKeyIds ? writerWrite(writer, item, trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_UNSIGNED_INT, propIndex))
+                                     : writerAppendCborText(writer, key, strlen(key));
+    if (success)
     {
-        props[propIndex].debounceDelayMs = debounceDelayMs;
-        return true;
+        switch (propsHot.kind[propIndex])
+        {
+        case PROP_KIND_STRING:
+            success = writerAppendCborText(writer, propsCold->lastPubStringValue[propIndex], propsCold->lastPubStringLength[propIndex]);
+            break;
+        case PROP_KIND_FLOAT:
+            success = writerWrite(writer, item, trackleUtilsCborEncodeFloat(item, floatFromBits((int32_t)value)));
+            break;
+        case PROP_KIND_INT64:
+            success = writerWrite(writer, item, trackleUtilsCborEncodeInt(item, value));
+            break;
+        case PROP_KIND_UINT64:
+            success = writerWrite(writer, item, trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_UNSIGNED_INT, (uint64_t)value));
+            break;
+        case PROP_KIND_ENUM:
+        {
+            const char *label = propsCold->labels[propIndex][value];
+            success = writerAppendCborText(writer, label, strlen(label));
+            break;
+        }
+        case PROP_KIND_SERIES:
+            success = appendSeriesToCbor(writer, propIndex);
+            break;
+        case PROP_KIND_BITFIELD:
+            if (propsCold->format[propIndex] == TRACKLE_BITFIELD_FORMAT_NAMED)
+            {
+                success = writerWrite(writer, item, trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_MAP, propsCold->numLabels[propIndex]));
+                for (int bit = 0; bit < propsCold->numLabels[propIndex] && success; bit++)
+                {
+                    const char *label = propsCold->labels[propIndex][bit];
+                    item[0] = ((uint32_t)value >> bit) & 1 ? TRACKLE_UTILS_CBOR_TRUE : TRACKLE_UTILS_CBOR_FALSE;
+                    success = writerAppendCborText(writer, label, strlen(label)) && writerWrite(writer, item, 1);
+                }
+            }
+            else
+                success = writerWrite(writer, item, trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_UNSIGNED_INT, (uint32_t)value));
+            break;
+        default:
+        {
+            const int exponent = getDecimalExponent(propsCold->scale[propIndex]);
+            if (exponent == 0)
+            { // integer
+                if (propsCold->sign[propIndex])
+                { // uint, remove sign
+                    success = writerWrite(writer, item, trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_UNSIGNED_INT, (uint32_t)value));
+                }
+                else
+                {
+                    success = writerWrite(writer, item, trackleUtilsCborEncodeInt(item, (int32_t)value));
+                }
+            }
+            else if (exponent > 0)
+            { // decimal fraction: [-exponent, value]
+                size_t itemLength = trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_TAG, TRACKLE_UTILS_CBOR_TAG_DECIMAL_FRACTION);
+                itemLength += trackleUtilsCborEncodeHead(item + itemLength, TRACKLE_UTILS_CBOR_ARRAY, 2);
+                itemLength += trackleUtilsCborEncodeInt(item + itemLength, -exponent);
+                success = writerWrite(writer, item, itemLength) && writerWrite(writer, item, trackleUtilsCborEncodeInt(item, (int32_t)value));
+            }
+            else
+            { // double
+                success = writerWrite(writer, item, trackleUtilsCborEncodeDouble(item, ((double)(int32_t)value) / propsCold->scale[propIndex]));
+            }
+            break;
+        }
+        }
     }
-    return false;
+    if (!success)
+    {
+        writer->length = initialLength;
+    }
+    return success;
 }
 
-bool Trackle_Prop_isDisabled(Trackle_PropID_t propID)
+// Time the payload was started [ms]: wall-clock time if the wall clock is set (returns true), time of the engines otherwise.
+static bool getPayloadTimeMs(const PayloadWriter_t *writer, uint64_t *timeMs)
 {
-    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
-    if (propIndex >= 0 && propIndex < numPropsCreated)
+    uint64_t wallMs;
+    if (trackleUtilsGetWallClockMs(&wallMs))
     {
-        return props[propIndex].disabled;
+        *timeMs = wallMs - (trackleUtilsNowUs() - writer->startUs) / 1000;
+        return true;
     }
+    *timeMs = writer->startUs / 1000;
     return false;
 }
 
-const char *Trackle_Prop_getKey(Trackle_PropID_t propID)
+static void beginJson(PayloadWriter_t *writer)
 {
-    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
-    if (propIndex >= 0 && propIndex < numPropsCreated)
+    writerPrintf(writer, "{");
+    if (writer->useKeyIds)
     {
-        return props[propIndex].key;
+        writerPrintf(writer, "\"" KEY_DICTIONARY_VERSION_KEY "\":\"%08" PRIx32 "\"", keyDictionaryVersion);
+    }
+    if (timestampsMode != TRACKLE_PROPS_TIMESTAMPS_NONE)
+    {
+        uint64_t timeMs;
+        const bool wallClock = getPayloadTimeMs(writer, &timeMs);
+        writerPrintf(writer, "%s\"%s\":%" PRIu64 ",\"" PAYLOAD_SEQ_KEY "\":%" PRIu32, writer->length > 1 ? "," : "",
+                     wallClock ? PAYLOAD_WALL_TIME_KEY : PAYLOAD_BOOT_TIME_KEY, timeMs, nextPayloadSeq);
     }
-    return EMPTY_STRING;
 }
 
-int32_t Trackle_Prop_getValue(Trackle_PropID_t propID)
+static size_t endJson(PayloadWriter_t *writer, char *slotBuffer)
 {
-    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
-    if (propIndex >= 0 && propIndex < numPropsCreated)
+    if (timestampsMode == TRACKLE_PROPS_TIMESTAMPS_PROPERTY)
     {
-        return props[propIndex].setValue;
+        writer->size = writer->serializer->size; // Release the room reserved for the ages
+        writerPrintf(writer, ",\"" PAYLOAD_AGES_KEY "\":[");
+        for (int a = 0; a < writer->numAges; a++)
+        {
+            writerPrintf(writer, a == 0 ? "%" PRIu32 : ",%" PRIu32, writer->ages[a]);
+        }
+        writerPrintf(writer, "]");
     }
-    return -1;
+    strcpy(writer->buffer + writer->length, "}"); // The buffer is the one of the slot
+    return writer->length + 1;
+}
+
+static void beginCbor(PayloadWriter_t *writer)
+{
+    const uint8_t mapStart = TRACKLE_UTILS_CBOR_MAP_INDEFINITE; // The number of properties isn't known in advance
+    writerWrite(writer, &mapStart, 1);
+    if (writer->useKeyIds)
+    {
+        uint8_t item[9];
+        writerAppendCborText(writer, KEY_DICTIONARY_VERSION_KEY, strlen(KEY_DICTIONARY_VERSION_KEY));
+        writerWrite(writer, item, trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_UNSIGNED_INT, keyDictionaryVersion));
+    }
+    if (timestampsMode != TRACKLE_PROPS_TIMESTAMPS_NONE)
+    {
+        uint8_t item[9];
+        uint64_t timeMs;
+        const char *timeKey = getPayloadTimeMs(writer, &timeMs) ? PAYLOAD_WALL_TIME_KEY : PAYLOAD_BOOT_TIME_KEY;
+        writerAppendCborText(writer, timeKey, strlen(timeKey));
+        writerWrite(writer, item, trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_UNSIGNED_INT, timeMs));
+        writerAppendCborText(writer, PAYLOAD_SEQ_KEY, strlen(PAYLOAD_SEQ_KEY));
+        writerWrite(writer, item, trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_UNSIGNED_INT, nextPayloadSeq));
+    }
+}
+
+static size_t endCbor(PayloadWriter_t *writer, char *slotBuffer)
+{
+    if (timestampsMode == TRACKLE_PROPS_TIMESTAMPS_PROPERTY)
+    {
+        uint8_t item[9];
+        writer->size = writer->serializer->size; // Release the room reserved for the ages
+        writerAppendCborText(writer, PAYLOAD_AGES_KEY, strlen(PAYLOAD_AGES_KEY));
+        writerWrite(writer, item, trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_ARRAY, writer->numAges));
+        for (int a = 0; a < writer->numAges; a++)
+        {
+            writerWrite(writer, item, trackleUtilsCborEncodeHead(item, TRACKLE_UTILS_CBOR_UNSIGNED_INT, writer->ages[a]));
+        }
+    }
+    writer->buffer[writer->length++] = (char)TRACKLE_UTILS_CBOR_BREAK;
+    return trackleUtilsBase64Encode(slotBuffer, (const uint8_t *)writer->buffer, writer->length);
+}
+
+// Serializers, indexed by Trackle_PropsEncoding_t
+static const PayloadSerializer_t serializers[PAYLOAD_ENCODINGS_NUM] = {
+    {
+        .size = JSON_BUFFER_LEN - 2, // Room for closing brace and null char
+        .agesLength = 9,             // ,"_dt":[]
+        .ageLength = 11,             // ,4294967295
+        .begin = beginJson,
+        .appendProp = appendPropertyToJsonString,
+        .end = endJson,
+    },
+    {
+        .size = CBOR_BUFFER_LEN - 1, // Room for break
+        .agesLength = 7,             // Text "_dt" and head of the array
+        .ageLength = 5,              // Unsigned int up to 32 bits
+        .begin = beginCbor,
+        .appendProp = appendPropertyToCbor,
+        .end = endCbor,
+    },
+};
+
+static bool isWideProp(int propIndex)
+{
+    return propsHot.kind[propIndex] == PROP_KIND_INT64 || propsHot.kind[propIndex] == PROP_KIND_UINT64;
+}
+
+// True for the kinds whose value is a plain int32, that can be updated by \ref Trackle_Prop_update.
+static bool isInt32Prop(int propIndex)
+{
+    return propsHot.kind[propIndex] == PROP_KIND_NUMBER || propsHot.kind[propIndex] == PROP_KIND_BITFIELD || propsHot.kind[propIndex] == PROP_KIND_ENUM;
+}
+
+// True if the property has an int32 value and the new value is valid for it (the index of a label for enums).
+static bool isValidInt32Value(int propIndex, int32_t value)
+{
+    if (propsHot.kind[propIndex] == PROP_KIND_ENUM)
+    {
+        return value >= 0 && value < propsCold->numLabels[propIndex];
+    }
+    return isInt32Prop(propIndex);
+}
+
+// Latest set value of a property that isn't a string, widened to 64 bits.
+static int64_t readSetValue(int propIndex)
+{
+    if (isWideProp(propIndex))
+    {
+        portENTER_CRITICAL(&valuesLock);
+        const int64_t value = wideValues->setValue[propsHot.setValue[propIndex]];
+        portEXIT_CRITICAL(&valuesLock);
+        return value;
+    }
+    return propsHot.setValue[propIndex];
+}
+
+// Latest published value of a property that isn't a string, widened to 64 bits.
+static int64_t readLastPubValue(int propIndex)
+{
+    return isWideProp(propIndex) ? wideValues->lastPubValue[propsHot.setValue[propIndex]] : propsHot.lastPubValue[propIndex];
+}
+
+static void writeLastPubValue(int propIndex, int64_t value)
+{
+    if (isWideProp(propIndex))
+        wideValues->lastPubValue[propsHot.setValue[propIndex]] = value;
+    else
+        propsHot.lastPubValue[propIndex] = (int32_t)value;
+}
+
+// Floats and bitfields are compared by their bits: a bitfield changed if the XOR with the published mask isn't 0.
+static bool isSetValueEqualToLastSent(int propIndex)
+{
+    switch (propsHot.kind[propIndex])
+    {
+    case PROP_KIND_STRING:
+        // Different hashes or lengths are enough to tell that strings differ, equal ones are confirmed by the content
+        return propsHot.setValue[propIndex] == propsHot.lastPubValue[propIndex] &&
+               propsCold->setStringLength[propIndex] == propsCold->lastPubStringLength[propIndex] &&
+               (propsCold->setStringValue[propIndex] == propsCold->lastPubStringValue[propIndex] ||
+                memcmp(propsCold->setStringValue[propIndex], propsCold->lastPubStringValue[propIndex], propsCold->setStringLength[propIndex]) == 0);
+    case PROP_KIND_INT64:
+    case PROP_KIND_UINT64:
+        return readSetValue(propIndex) == readLastPubValue(propIndex);
+    default:
+        return propsHot.setValue[propIndex] == propsHot.lastPubValue[propIndex];
+    }
+}
+
+// Strings are updated before being serialized from the published buffer, that API callers never write.
+static void updateLastSentToSetValue(int propIndex, int64_t value)
+{
+    if (propsHot.kind[propIndex] == PROP_KIND_STRING)
+    {
+        // The published value takes the buffer of the set value, and its own buffer becomes the spare one: the next
+        // update writes there, so that the published value is never copied nor overwritten while it's serialized.
+        portENTER_CRITICAL(&valuesLock);
+        if (propsCold->lastPubStringValue[propIndex] != propsCold->setStringValue[propIndex])
+        {
+            propsCold->spareStringValue[propIndex] = propsCold->lastPubStringValue[propIndex];
+            propsCold->lastPubStringValue[propIndex] = propsCold->setStringValue[propIndex];
+        }
+        propsCold->lastPubStringLength[propIndex] = propsCold->setStringLength[propIndex];
+        propsHot.lastPubValue[propIndex] = propsHot.setValue[propIndex];
+        portEXIT_CRITICAL(&valuesLock);
+    }
+    else
+        writeLastPubValue(propIndex, value);
+}
+
+// Times are 64-bit microseconds, that never wrap.
+static bool isElapsed(int64_t nowUs, int64_t startUs, int64_t delayUs)
+{
+    return nowUs - startUs >= delayUs;
+}
+
+// Deadlines are checked by a task that wakes up on the tick: one reached within the current tick counts as reached,
+// or it would wait for the next round.
+static bool isDeadlineReached(int64_t nowUs, int64_t deadlineUs)
+{
+    return nowUs + DEADLINE_TOLERANCE_US >= deadlineUs;
+}
+
+// The times of the properties are written by API callers and read by the task.
+static int64_t readSetTimeUs(int propIdx)
+{
+    portENTER_CRITICAL(&timesLock);
+    const int64_t timeUs = propsHot.latestSetTimeUs[propIdx];
+    portEXIT_CRITICAL(&timesLock);
+    return timeUs;
+}
+
+static void writeSetTimeUs(int propIdx, int64_t timeUs)
+{
+    portENTER_CRITICAL(&timesLock);
+    propsHot.latestSetTimeUs[propIdx] = timeUs;
+    portEXIT_CRITICAL(&timesLock);
+}
+
+// Time the debounce of the property expires, if it isn't set again.
+static int64_t getSettleTimeUs(int propIdx)
+{
+    portENTER_CRITICAL(&timesLock);
+    const int64_t settleUs = propsHot.latestSetTimeUs[propIdx] + propsHot.debounceDelayUs[propIdx];
+    portEXIT_CRITICAL(&timesLock);
+    return settleUs;
+}
+
+// True if a series has samples to be published, and none being sent.
+static bool isSeriesToPublish(int propIdx)
+{
+    const Series_t *ring = &series[propsHot.setValue[propIdx]];
+    return !ring->inFlight && ring->count > 0;
+}
+
+static bool isPropToPublish(int propIdx, bool onlyIfChanged)
+{
+    const uint8_t flags = propsHot.flags[propIdx];
+    if (propsHot.kind[propIdx] == PROP_KIND_SERIES)
+    {
+        return !propsHot.disabled[propIdx] && isSeriesToPublish(propIdx); // Whenever there are new samples
+    }
+    return !propsHot.disabled[propIdx] && (((flags & PROP_FLAG_CHANGED) && ((flags & PROP_FLAG_RESEND) || !isSetValueEqualToLastSent(propIdx))) || !onlyIfChanged);
+}
+
+static bool isPropToResync(int propIdx)
+{
+    const uint8_t flags = propsHot.flags[propIdx];
+    return (propsHot.config[propIdx] & PROP_CONFIG_GROUPED) && !(flags & PROP_FLAG_SYNCED) && !propsHot.disabled[propIdx] &&
+           !((flags & PROP_FLAG_RESTORED) && isSetValueEqualToLastSent(propIdx)) && // The cloud already has it from before the reboot
+           (propsHot.kind[propIdx] != PROP_KIND_SERIES || isSeriesToPublish(propIdx));
+}
+
+static bool isPropInBitset(const uint32_t *bitset, int propIdx)
+{
+    return (bitset[propIdx / 32] >> (propIdx % 32)) & 1;
+}
+
+static void addPropToBitset(uint32_t *bitset, int propIdx)
+{
+    bitset[propIdx / 32] |= (uint32_t)1 << (propIdx % 32);
+}
+
+static bool isBitsetEmpty(const uint32_t *bitset)
+{
+    for (int word = 0; word < PROPS_BITSET_WORDS; word++)
+    {
+        if (bitset[word] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void removePropFromBitset(uint32_t *bitset, int propIdx)
+{
+    bitset[propIdx / 32] &= ~((uint32_t)1 << (propIdx % 32));
+}
+
+static void setPublishSlotState(int slotIdx, PublishSlotState_t state)
+{
+    portENTER_CRITICAL(&publishSlotsLock);
+    publishSlots[slotIdx].state = state;
+    portEXIT_CRITICAL(&publishSlotsLock);
+}
+
+static PublishSlotState_t getPublishSlotState(int slotIdx)
+{
+    portENTER_CRITICAL(&publishSlotsLock);
+    const PublishSlotState_t state = publishSlots[slotIdx].state;
+    portEXIT_CRITICAL(&publishSlotsLock);
+    return state;
+}
+
+// Get the index of a free slot, cleared for a new payload. Returns -1 if all the slots are waiting to be sent.
+static int takeFreePublishSlot()
+{
+    for (int slotIdx = 0; slotIdx < numPublishSlots; slotIdx++)
+    {
+        if (getPublishSlotState(slotIdx) == PUBLISH_SLOT_FREE)
+        {
+            memset(publishSlots[slotIdx].members, 0, sizeof(publishSlots[slotIdx].members));
+            publishSlots[slotIdx].buffer[0] = '\0';
+            publishSlots[slotIdx].dictionaryEnd = 0;
+            return slotIdx;
+        }
+    }
+    return -1;
+}
+
+// Sender stage: send the payload at the head of the queue, if connected and allowed by the retry policy.
+// A payload that fails is kept at the head of the queue and sent again as it is, until it succeeds or the retry budget is exhausted.
+// It can run in the properties task or in the sender task. Returns true if the queue was emptied or the payload can be retried right away.
+static bool sendQueuedPublishSlot()
+{
+    int slotIdx;
+    const uint32_t nowMs = trackleUtilsNowMs();
+    if (xQueuePeek(sendQueue, &slotIdx, 0) != pdTRUE)
+    {
+        return true;
+    }
+    if (!trackleConnected(trackle_s) || !trackleUtilsRetryIsDue(&sendRetry, nowMs))
+    {
+        return false;
+    }
+
+    PublishSlot_t *slot = &publishSlots[slotIdx];
+    if (slot->retries > 0)
+    {
+        publishStats.retries++;
+    }
+    const bool sent = slot->dictionaryEnd > 0 ? tracklePublishSecure(TRACKLE_PROPS_KEY_DICTIONARY_EVENT, slot->buffer) : trackleSyncStateSecure(slot->buffer);
+    if (sent)
+    {
+        publishStats.published++;
+        trackleUtilsRetryReset(&sendRetry);
+        xQueueReceive(sendQueue, &slotIdx, 0);
+        setPublishSlotState(slotIdx, PUBLISH_SLOT_SENT);
+        return true;
+    }
+
+    publishStats.failures++;
+    trackleUtilsRetryOnFailure(&sendRetry, &retryPolicy, nowMs);
+    if (trackleUtilsRetryIsBudgetExhausted(&retryPolicy, slot->retries))
+    {
+        publishStats.dropped++;
+        xQueueReceive(sendQueue, &slotIdx, 0);
+        setPublishSlotState(slotIdx, PUBLISH_SLOT_FAILED);
+        return true;
+    }
+    slot->retries++;
+    return false;
+}
+
+// Apply the results of the slots that were sent (or failed) and make them available again.
+static void collectPublishSlots()
+{
+    for (int slotIdx = 0; slotIdx < numPublishSlots; slotIdx++)
+    {
+        const PublishSlotState_t state = getPublishSlotState(slotIdx);
+        if (state != PUBLISH_SLOT_SENT && state != PUBLISH_SLOT_FAILED)
+        {
+            continue;
+        }
+        const PublishSlot_t *slot = &publishSlots[slotIdx];
+        if (slot->dictionaryEnd > 0 && slot->dictionarySession == keyDictionarySession)
+        {
+            if (state == PUBLISH_SLOT_SENT)
+            {
+                keyDictionaryPublished = slot->dictionaryEnd;
+            }
+            else
+            {
+                // The chunks queued after the failed one are ignored: the dictionary is queued again from the failed chunk
+                keyDictionarySession++;
+                keyDictionaryQueued = keyDictionaryPublished;
+            }
+        }
+        for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+        {
+            if (isPropInBitset(publishSlots[slotIdx].members, pIdx))
+            {
+                if (propsHot.kind[pIdx] == PROP_KIND_SERIES)
+                {
+                    // Samples delivered are released, failed ones are sent again
+                    Series_t *ring = &series[propsHot.setValue[pIdx]];
+                    if (state == PUBLISH_SLOT_SENT)
+                    {
+                        portENTER_CRITICAL(&valuesLock);
+                        ring->first = (ring->first + ring->sentCount) % ring->capacity;
+                        ring->count -= ring->sentCount;
+                        portEXIT_CRITICAL(&valuesLock);
+                    }
+                    ring->inFlight = false;
+                }
+                if (state == PUBLISH_SLOT_SENT)
+                {
+                    if (isSetValueEqualToLastSent(pIdx))
+                        propsHot.flags[pIdx] &= ~PROP_FLAG_CHANGED; // Unless it changed again while the payload was being sent
+                    if (propsHot.kind[pIdx] == PROP_KIND_STRING)
+                        addPropToBitset(persistenceStringsDirty, pIdx);
+                    else if (propsHot.kind[pIdx] != PROP_KIND_SERIES)
+                        persistenceValuesDirty = true;
+                }
+                else if (state == PUBLISH_SLOT_FAILED)
+                {
+                    propsHot.flags[pIdx] |= PROP_FLAG_CHANGED | PROP_FLAG_RESEND;
+                    if (propsHot.flags[pIdx] & PROP_FLAG_SYNCED)
+                    {
+                        // It must be part of the resync again
+                        propsHot.flags[pIdx] &= ~PROP_FLAG_SYNCED;
+                        resyncActive = true;
+                    }
+                }
+            }
+        }
+        setPublishSlotState(slotIdx, PUBLISH_SLOT_FREE);
+    }
+}
+
+// Hash of data following the bytes already hashed in hash.
+static uint32_t continueHash(uint32_t hash, const char *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ (uint8_t)data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t hashBytes(const char *data, size_t length)
+{
+    return continueHash(2166136261u, data, length); // FNV-1a
+}
+
+static uint32_t hashKey(const char *key)
+{
+    return hashBytes(key, strlen(key));
+}
+
+static void makeStringPersistenceKey(char *nvsKey, int propIdx)
+{
+    sprintf(nvsKey, "s%08" PRIx32, hashKey(propsCold->key[propIdx]));
+}
+
+// Store in NVS the last published values that changed, at most once every persistenceMinIntervalMs, and only when no
+// payload is waiting to be sent, so that only values known to be on the cloud are stored.
+static void persistLastPublishedValues(int64_t nowUs)
+{
+    bool stringsDirty = false;
+    for (int w = 0; w < PROPS_BITSET_WORDS; w++)
+    {
+        stringsDirty |= persistenceStringsDirty[w] != 0;
+    }
+    if (!persistenceEnabled || (!persistenceValuesDirty && !stringsDirty) || !isElapsed(nowUs, persistenceLatestWriteUs, (int64_t)persistenceMinIntervalMs * 1000))
+    {
+        return;
+    }
+    for (int slotIdx = 0; slotIdx < numPublishSlots; slotIdx++)
+    {
+        if (getPublishSlotState(slotIdx) != PUBLISH_SLOT_FREE)
+        {
+            return;
+        }
+    }
+
+    esp_err_t err = ESP_OK;
+    if (persistenceValuesDirty)
+    {
+        PersistedValue_t values[TRACKLE_MAX_PROPS_NUM];
+        int numValues = 0;
+        for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+        {
+            // Only values known to be on the cloud: published since the latest resync started (and not failed since),
+            // or restored at boot and not published again. Defaults never sent must be published after a reboot.
+            const uint8_t flags = propsHot.flags[pIdx];
+            if (propsHot.kind[pIdx] != PROP_KIND_STRING && propsHot.kind[pIdx] != PROP_KIND_SERIES &&
+                !(flags & PROP_FLAG_RESEND) && (flags & (PROP_FLAG_SYNCED | PROP_FLAG_RESTORED)))
+            {
+                values[numValues].keyHash = hashKey(propsCold->key[pIdx]);
+                values[numValues].value = readLastPubValue(pIdx);
+                numValues++;
+            }
+        }
+        err = nvs_set_blob(persistenceHandle, PERSISTENCE_VALUES_KEY, values, numValues * sizeof(PersistedValue_t));
+        persistenceValuesDirty = err != ESP_OK;
+    }
+    for (int pIdx = 0; pIdx < numPropsCreated && err == ESP_OK; pIdx++)
+    {
+        if (isPropInBitset(persistenceStringsDirty, pIdx) && !(propsHot.flags[pIdx] & PROP_FLAG_RESEND))
+        {
+            char nvsKey[16];
+            makeStringPersistenceKey(nvsKey, pIdx);
+            err = nvs_set_blob(persistenceHandle, nvsKey, propsCold->lastPubStringValue[pIdx], propsCold->lastPubStringLength[pIdx] + 1);
+        }
+    }
+    if (err == ESP_OK)
+    {
+        memset(persistenceStringsDirty, 0, sizeof(persistenceStringsDirty));
+        err = nvs_commit(persistenceHandle);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Error storing last published values: %s", esp_err_to_name(err));
+    }
+    persistenceLatestWriteUs = nowUs;
+}
+
+// Restore from NVS the last published values of the properties created so far.
+static void restoreLastPublishedValues()
+{
+    PersistedValue_t values[TRACKLE_MAX_PROPS_NUM];
+    size_t valuesSize = sizeof(values);
+    if (nvs_get_blob(persistenceHandle, PERSISTENCE_VALUES_KEY, values, &valuesSize) != ESP_OK)
+    {
+        valuesSize = 0;
+    }
+    const int numValues = valuesSize / sizeof(PersistedValue_t);
+
+    for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+    {
+        if (propsHot.kind[pIdx] == PROP_KIND_STRING)
+        {
+            char nvsKey[16];
+            size_t stringSize = propsCold->stringValueMaxLength[pIdx] + 1;
+            makeStringPersistenceKey(nvsKey, pIdx);
+            if (nvs_get_blob(persistenceHandle, nvsKey, propsCold->lastPubStringValue[pIdx], &stringSize) == ESP_OK)
+            {
+                propsCold->lastPubStringValue[pIdx][stringSize - 1] = '\0';
+                propsCold->lastPubStringLength[pIdx] = strlen(propsCold->lastPubStringValue[pIdx]);
+                propsHot.lastPubValue[pIdx] = hashBytes(propsCold->lastPubStringValue[pIdx], propsCold->lastPubStringLength[pIdx]);
+                propsHot.flags[pIdx] |= PROP_FLAG_RESTORED;
+            }
+            continue;
+        }
+        if (propsHot.kind[pIdx] == PROP_KIND_SERIES)
+        {
+            continue; // Samples are not persisted
+        }
+        const uint32_t keyHash = hashKey(propsCold->key[pIdx]);
+        for (int vIdx = 0; vIdx < numValues; vIdx++)
+        {
+            if (values[vIdx].keyHash == keyHash)
+            {
+                writeLastPubValue(pIdx, values[vIdx].value);
+                propsHot.flags[pIdx] |= PROP_FLAG_RESTORED;
+                break;
+            }
+        }
+    }
+}
+
+// Start publishing again all the properties in groups, after a random phase within the resync window.
+static void startResync(int64_t nowUs)
+{
+    for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+    {
+        propsHot.flags[pIdx] &= everConnected ? ~(PROP_FLAG_SYNCED | PROP_FLAG_RESTORED) : ~PROP_FLAG_SYNCED; // Restored values only matter at first connection
+    }
+    resyncActive = true;
+    resyncNextChunkUs = nowUs + (resyncConfig.windowMs > 0 ? (int64_t)(esp_random() % resyncConfig.windowMs) * 1000 : 0);
+}
+
+// Add the property with the given value (ignored for strings) to the payload being built in the slot. Returns false if there is no room for it.
+static bool addPropValueToPayload(PublishSlot_t *slot, PayloadWriter_t *writer, int propIdx, int64_t value)
+{
+    const bool isString = propsHot.kind[propIdx] == PROP_KIND_STRING;
+    if (isString)
+    {
+        updateLastSentToSetValue(propIdx, value); // If it doesn't fit, RESEND makes it published anyway
+    }
+
+    // Room for the age of the value is reserved together with the property
+    const size_t ageLength = timestampsMode == TRACKLE_PROPS_TIMESTAMPS_PROPERTY ? writer->serializer->ageLength : 0;
+    if (writer->length <= writer->size && writer->size - writer->length >= ageLength)
+    {
+        writer->size -= ageLength;
+        if (writer->serializer->appendProp(writer, propIdx, value))
+        {
+            // Values set after the payload was started (by API tasks, while it's serialized) are as recent as the payload
+            const int64_t ageUs = writer->startUs - readSetTimeUs(propIdx);
+            writer->ages[writer->numAges++] = ageUs > 0 ? (uint32_t)(ageUs / 1000) : 0;
+            addPropToBitset(slot->members, propIdx);
+            propsHot.flags[propIdx] = (propsHot.flags[propIdx] & ~PROP_FLAG_RESEND) | PROP_FLAG_SYNCED;
+            if (!isString)
+            {
+                updateLastSentToSetValue(propIdx, value);
+            }
+            return true;
+        }
+        writer->size += ageLength;
+    }
+    // No room left in the payload, publish it at next round.
+    propsHot.flags[propIdx] |= PROP_FLAG_CHANGED | PROP_FLAG_RESEND;
+    return false;
+}
+
+// Add the property to the payload together with the properties in groups whose latest values were committed by the same
+// transaction and aren't published yet, with the values they have at the same instant. Either all of them are added, or
+// none. Returns false if there is no room for them.
+static bool addTxnToPayload(PublishSlot_t *slot, PayloadWriter_t *writer, int propIdx, uint16_t txnId)
+{
+    int membersIdx[TRACKLE_PROP_TXN_MAX_UPDATES];
+    int32_t membersValue[TRACKLE_PROP_TXN_MAX_UPDATES];
+    int numMembers = 0;
+    portENTER_CRITICAL(&txnLock);
+    for (int pIdx = 0; pIdx < numPropsCreated && numMembers < TRACKLE_PROP_TXN_MAX_UPDATES; pIdx++)
+    {
+        // Values already published (or being published) are left out, the cloud has them already
+        const bool unpublished = propsHot.setValue[pIdx] != propsHot.lastPubValue[pIdx] || (propsHot.flags[pIdx] & PROP_FLAG_RESEND);
+        if (propsHot.txnId[pIdx] == txnId && !propsHot.disabled[pIdx] && !isPropInBitset(slot->members, pIdx) &&
+            (pIdx == propIdx || ((propsHot.config[pIdx] & PROP_CONFIG_GROUPED) && unpublished)))
+        {
+            membersIdx[numMembers] = pIdx;
+            membersValue[numMembers] = propsHot.setValue[pIdx];
+            numMembers++;
+        }
+    }
+    portEXIT_CRITICAL(&txnLock);
+
+    const size_t initialLength = writer->length;
+    const size_t initialSize = writer->size;
+    const uint16_t initialNumAges = writer->numAges;
+    for (int m = 0; m < numMembers; m++)
+    {
+        if (!addPropValueToPayload(slot, writer, membersIdx[m], membersValue[m]))
+        {
+            // Roll back the members already added, they will be published all together at next round
+            writer->length = initialLength;
+            writer->size = initialSize;
+            writer->numAges = initialNumAges;
+            writer->buffer[initialLength] = '\0';
+            for (int r = 0; r < numMembers; r++)
+            {
+                removePropFromBitset(slot->members, membersIdx[r]);
+                propsHot.flags[membersIdx[r]] |= PROP_FLAG_CHANGED | PROP_FLAG_RESEND;
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+// Add the property to the payload being built in the slot, together with the other properties of its transaction if
+// any. Returns false if there is no room for it.
+static bool addPropToPayload(PublishSlot_t *slot, PayloadWriter_t *writer, int propIdx)
+{
+    const uint16_t txnId = propsHot.txnId[propIdx];
+    if (txnId != 0)
+    {
+        return addTxnToPayload(slot, writer, propIdx, txnId);
+    }
+    return addPropValueToPayload(slot, writer, propIdx, propsHot.kind[propIdx] == PROP_KIND_STRING ? 0 : readSetValue(propIdx));
+}
+
+// Set the property as changed if its debounce delay is elapsed since it was set.
+static void applyDebounce(int propIdx, int64_t nowUs)
+{
+    if (!propsHot.debouncing[propIdx])
+    {
+        return;
+    }
+    portENTER_CRITICAL(&timesLock);
+    const bool elapsed = isElapsed(nowUs, propsHot.latestSetTimeUs[propIdx], propsHot.debounceDelayUs[propIdx]);
+    portEXIT_CRITICAL(&timesLock);
+    if (elapsed)
+    {
+        propsHot.debouncing[propIdx] = false;
+        propsHot.flags[propIdx] |= PROP_FLAG_CHANGED;
+    }
+}
+
+// True if a property of a group published on settle settled since it was set, and the min interval since the latest
+// publication of the group is elapsed. Debounce is applied to all the properties of the group.
+static bool isGroupSettled(const PropGroup_t *group, int64_t nowUs)
+{
+    if (!isElapsed(nowUs, group->latestPublishUs, (int64_t)group->settleMinIntervalMs * 1000))
+    {
+        return false;
+    }
+    bool settled = false;
+    for (int i = 0; i < group->propsWithin; i++)
+    {
+        const int pIdx = group->propsIndexes[i];
+        if (propsHot.kind[pIdx] == PROP_KIND_SERIES)
+        {
+            continue; // Samples aren't debounced, they wait for the period
+        }
+        applyDebounce(pIdx, nowUs);
+        settled |= !propsHot.debouncing[pIdx] && isPropToPublish(pIdx, true);
+    }
+    return settled;
+}
+
+// Arm the settle timer for the earliest time a group published on settle may become settled: when the debounce of one
+// of its properties expires, or when its min interval elapses. Groups that are already settled but weren't published
+// at this round (no free slot, no budget) wait for the next round of the task.
+static void armSettleTimer(int64_t nowUs)
+{
+    if (settleTimer == NULL)
+    {
+        return;
+    }
+
+    // Properties set from now on wake the engine up, as their debounce may expire before the new deadline
+    portENTER_CRITICAL(&timesLock);
+    settleTimerDeadlineUs = INT64_MAX;
+    portEXIT_CRITICAL(&timesLock);
+
+    int64_t deadlineUs = INT64_MAX;
+    for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
+    {
+        const PropGroup_t *group = &propGroups[pgIdx];
+        const int64_t minIntervalEndUs = group->latestPublishUs + (int64_t)group->settleMinIntervalMs * 1000;
+        for (int i = 0; group->publishOnSettle && i < group->propsWithin; i++)
+        {
+            const int pIdx = group->propsIndexes[i];
+            int64_t settleUs;
+            if (propsHot.kind[pIdx] == PROP_KIND_SERIES || propsHot.disabled[pIdx])
+            {
+                continue;
+            }
+            if (propsHot.debouncing[pIdx])
+            {
+                settleUs = getSettleTimeUs(pIdx);
+            }
+            else if (isPropToPublish(pIdx, true))
+            {
+                settleUs = nowUs;
+            }
+            else
+            {
+                continue;
+            }
+            settleUs = settleUs > minIntervalEndUs ? settleUs : minIntervalEndUs;
+            if (settleUs > nowUs && settleUs < deadlineUs)
+            {
+                deadlineUs = settleUs;
+            }
+        }
+    }
+
+    portENTER_CRITICAL(&timesLock);
+    const bool woken = settleTimerDeadlineUs != INT64_MAX; // A property was set meanwhile: the engine runs again anyway
+    if (!woken)
+    {
+        settleTimerDeadlineUs = deadlineUs;
+    }
+    portEXIT_CRITICAL(&timesLock);
+    esp_timer_stop(settleTimer); // Fails if the timer isn't running, that's fine
+    if (!woken && deadlineUs != INT64_MAX)
+    {
+        esp_timer_start_once(settleTimer, deadlineUs - nowUs);
+    }
+}
+
+// Add to the payload the changed urgent properties, whatever their groups. Urgent properties still within their debounce
+// delay keep the scan pending, so that they are published as soon as the delay is elapsed.
+static void addUrgentPropsToPayload(PublishSlot_t *slot, PayloadWriter_t *writer, int64_t nowUs)
+{
+    urgentPending = false; // Before the scan, so that updates made meanwhile are not lost
+    for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+    {
+        if (!(propsHot.config[pIdx] & PROP_CONFIG_URGENT))
+        {
+            continue;
+        }
+        applyDebounce(pIdx, nowUs);
+        if (propsHot.debouncing[pIdx])
+        {
+            urgentPending = true;
+        }
+        else if (!isPropInBitset(slot->members, pIdx) && isPropToPublish(pIdx, true))
+        {
+            addPropToPayload(slot, writer, pIdx);
+        }
+    }
+}
+
+// Add to the payload the next chunk of properties not synced yet, in order of priority.
+static void addResyncChunkToPayload(PublishSlot_t *slot, PayloadWriter_t *writer, int64_t nowUs)
+{
+    int added = 0;
+    bool unsyncedLeft = false;
+    for (int priority = TRACKLE_PROP_PRIORITY_URGENT; priority >= TRACKLE_PROP_PRIORITY_LOW; priority--)
+    {
+        for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+        {
+            if (propsCold->priority[pIdx] != priority || !isPropToResync(pIdx))
+            {
+                continue;
+            }
+            if ((resyncConfig.chunkProps != 0 && added >= resyncConfig.chunkProps) || !addPropToPayload(slot, writer, pIdx))
+            {
+                unsyncedLeft = true;
+                continue;
+            }
+            added++;
+        }
+    }
+    resyncActive = unsyncedLeft;
+    resyncNextChunkUs = nowUs + (int64_t)resyncConfig.chunkIntervalMs * 1000;
+}
+
+static void fillTokenBucket(TokenBucket_t *bucket, int64_t nowUs, uint32_t burst, int64_t periodUs)
+{
+    bucket->scaledTokens = burst * periodUs;
+    bucket->latestRefillUs = nowUs;
+}
+
+// Add the tokens accumulated since the latest refill at rate tokens per period, up to burst tokens.
+static void refillTokenBucket(TokenBucket_t *bucket, int64_t nowUs, uint32_t rate, uint32_t burst, int64_t periodUs)
+{
+    const int64_t fullScaledTokens = (int64_t)burst * periodUs;
+    if (bucket->scaledTokens < fullScaledTokens)
+    {
+        // Time counted up to when the bucket is full, so that the tokens don't overflow after a long disconnection
+        const int64_t fillUs = (fullScaledTokens - bucket->scaledTokens) / rate + 1;
+        const int64_t elapsedUs = nowUs - bucket->latestRefillUs;
+        bucket->scaledTokens += (elapsedUs < fillUs ? elapsedUs : fillUs) * rate;
+    }
+    if (bucket->scaledTokens > fullScaledTokens)
+    {
+        bucket->scaledTokens = fullScaledTokens;
+    }
+    bucket->latestRefillUs = nowUs;
+}
+
+// Refill the budget and return true if a payload can be published now.
+static bool isBudgetAvailable(int64_t nowUs)
+{
+    bool available = true;
+    if (budget.bytesPerSecond > 0)
+    {
+        refillTokenBucket(&budgetBytes, nowUs, budget.bytesPerSecond, budget.burstBytes > 0 ? budget.burstBytes : budget.bytesPerSecond, BUDGET_BYTES_PERIOD_US);
+        available &= budgetBytes.scaledTokens >= 0;
+    }
+    if (budget.payloadsPerMinute > 0)
+    {
+        refillTokenBucket(&budgetPayloads, nowUs, budget.payloadsPerMinute, budget.burstPayloads > 0 ? budget.burstPayloads : budget.payloadsPerMinute, BUDGET_PAYLOADS_PERIOD_US);
+        available &= budgetPayloads.scaledTokens >= BUDGET_PAYLOADS_PERIOD_US;
+    }
+    return available;
+}
+
+static void consumeBudget(size_t payloadBytes)
+{
+    budgetBytes.scaledTokens -= (int64_t)payloadBytes * BUDGET_BYTES_PERIOD_US;
+    budgetPayloads.scaledTokens -= BUDGET_PAYLOADS_PERIOD_US;
+}
+
+// Configuration of the deadlines of the group.
+static PropGroupCold_t *getGroupCold(const PropGroup_t *group)
+{
+    return &propGroupsCold[group - propGroups];
+}
+
+// Time of the first deadline after afterUs (not before nowUs) that is a multiple of the period of the group in
+// wall-clock time, or the one after a period if the wall clock isn't set.
+static int64_t getWallClockAlignedDeadlineUs(const PropGroup_t *group, int64_t nowUs, int64_t afterUs)
+{
+    uint64_t wallMs;
+    if (group->periodMs == 0 || !trackleUtilsGetWallClockMs(&wallMs))
+    {
+        return afterUs + (int64_t)group->periodMs * 1000;
+    }
+    const uint64_t afterWallMs = wallMs + (afterUs - nowUs) / 1000;
+    return afterUs + (int64_t)(group->periodMs - afterWallMs % group->periodMs) * 1000;
+}
+
+// Return true if the group must be published at this round, and move its deadline forward on the grid of its period.
+// Deadlines don't depend on when the task actually wakes up, so lateness doesn't accumulate. If whole periods were
+// missed, the group is published once or not at all, according to its policy, and the next deadline is the first
+// one on the grid after now.
+static bool scheduleGroup(PropGroup_t *group, int64_t nowUs)
+{
+    if (!isDeadlineReached(nowUs, group->nextDeadlineUs))
+    {
+        return false;
+    }
+    if (group->periodMs == 0)
+    {
+        group->nextDeadlineUs = nowUs;
+        return true;
+    }
+
+    bool due = true;
+    const int64_t reachedDeadlineUs = group->nextDeadlineUs;
+    const int64_t periodUs = (int64_t)group->periodMs * 1000;
+    const int64_t latenessUs = nowUs - group->nextDeadlineUs; // Negative if reached within the tolerance
+    if (latenessUs < periodUs)
+    {
+        group->nextDeadlineUs += periodUs;
+    }
+    else
+    {
+        due = getGroupCold(group)->missedPolicy == TRACKLE_PROPGROUP_MISSED_FIRE_ONCE;
+        group->nextDeadlineUs += (latenessUs / periodUs + 1) * periodUs;
+    }
+
+    // Follow the wall clock, that may have been set or adjusted meanwhile. A deadline reached up to a tick early must not
+    // be found again as the next one.
+    if (getGroupCold(group)->alignToWallClock)
+    {
+        const int64_t afterUs = reachedDeadlineUs + DEADLINE_TOLERANCE_US;
+        group->nextDeadlineUs = getWallClockAlignedDeadlineUs(group, nowUs, afterUs > nowUs ? afterUs : nowUs);
+    }
+    return due;
+}
+
+void trackleUtilsPropertiesBegin(int64_t nowUs)
+{
+    engineTaskHandle = xTaskGetCurrentTaskHandle();
+
+    // Consider this instant as 0 in the time of the properties
+    for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
+    {
+        propGroups[pgIdx].nextDeadlineUs = propGroupsCold[pgIdx].alignToWallClock ? getWallClockAlignedDeadlineUs(&propGroups[pgIdx], nowUs, nowUs) : nowUs + ((int64_t)propGroups[pgIdx].periodMs + propGroupsCold[pgIdx].phaseMs) * 1000;
+    }
+    for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
+    {
+        propGroups[pgIdx].latestPublishUs = nowUs;
+    }
+    fillTokenBucket(&budgetBytes, nowUs, budget.burstBytes > 0 ? budget.burstBytes : budget.bytesPerSecond, BUDGET_BYTES_PERIOD_US);
+    fillTokenBucket(&budgetPayloads, nowUs, budget.burstPayloads > 0 ? budget.burstPayloads : budget.payloadsPerMinute, BUDGET_PAYLOADS_PERIOD_US);
+}
+
+// Max number of bytes a property takes in a payload.
+static uint32_t estimatePropBytes(int propIdx)
+{
+    uint32_t valueBytes;
+    switch (propsHot.kind[propIdx])
+    {
+    case PROP_KIND_STRING:
+        valueBytes = propsCold->stringValueMaxLength[propIdx] + 2; // Quotes
+        break;
+    case PROP_KIND_FLOAT:
+        valueBytes = 16 + propsCold->numDecimals[propIdx]; // Typical magnitudes of sensor readings, point and decimals
+        break;
+    case PROP_KIND_INT64:
+    case PROP_KIND_UINT64:
+        valueBytes = 20; // "18446744073709551615"
+        break;
+    case PROP_KIND_ENUM:
+        valueBytes = 0;
+        for (int label = 0; label < propsCold->numLabels[propIdx]; label++)
+        {
+            const uint32_t labelBytes = strlen(propsCold->quotedLabels[propIdx][label]);
+            valueBytes = labelBytes > valueBytes ? labelBytes : valueBytes;
+        }
+        break;
+    case PROP_KIND_BITFIELD:
+        valueBytes = propsCold->format[propIdx] == TRACKLE_BITFIELD_FORMAT_NAMED ? 2 : 10; // Braces, or "4294967295"
+        for (int bit = 0; propsCold->format[propIdx] == TRACKLE_BITFIELD_FORMAT_NAMED && bit < propsCold->numLabels[propIdx]; bit++)
+        {
+            valueBytes += strlen(propsCold->labels[propIdx][bit]) + 9; // Quotes, colon, "false" and comma
+        }
+        break;
+    case PROP_KIND_SERIES:
+    {
+        const Series_t *ring = &series[propsHot.setValue[propIdx]];
+        const SeriesCold_t *config = &seriesCold[propsHot.setValue[propIdx]];
+        valueBytes = 40 + ring->capacity * (config->format == TRACKLE_SERIES_FORMAT_ARRAY ? 7 : 3); // Times, and typical samples or deltas
+        break;
+    }
+    default:
+        valueBytes = propsCold->scale[propIdx] == 1 ? 11 : 11 + 1 + propsCold->numDecimals[propIdx]; // "-2147483648", point and decimals
+        break;
+    }
+    return strlen(propsCold->key[propIdx]) + 4 + valueBytes; // Quotes, colon and comma around the key
+}
+
+// Max number of bytes the properties of a group take in a payload.
+static uint32_t estimateGroupBytes(const PropGroup_t *group)
+{
+    uint32_t bytes = 0;
+    for (int i = 0; i < group->propsWithin; i++)
+    {
+        bytes += estimatePropBytes(group->propsIndexes[i]);
+    }
+    return bytes;
+}
+
+static uint64_t gcd64(uint64_t a, uint64_t b)
+{
+    while (b != 0)
+    {
+        const uint64_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+// Number of bins of resolutionMs covering the hyperperiod of the groups (the least common multiple of their periods),
+// after which the deadlines repeat, limited to LOAD_MAX_BINS.
+static int getLoadBinsNumber(uint32_t resolutionMs)
+{
+    uint64_t hyperperiodMs = resolutionMs;
+    for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
+    {
+        const uint64_t periodMs = propGroups[pgIdx].periodMs > resolutionMs ? propGroups[pgIdx].periodMs : resolutionMs;
+        hyperperiodMs = hyperperiodMs / gcd64(hyperperiodMs, periodMs) * periodMs;
+        if (hyperperiodMs >= (uint64_t)LOAD_MAX_BINS * resolutionMs)
+        {
+            return LOAD_MAX_BINS;
+        }
+    }
+    return (hyperperiodMs + resolutionMs - 1) / resolutionMs;
+}
+
+// Add the predicted bytes of a group published with the given phase to the load of the bins (negative to remove them).
+static void addGroupLoad(uint32_t *binsBytes, int numBins, uint32_t resolutionMs, const PropGroup_t *group, uint32_t phaseMs, int32_t bytes)
+{
+    const uint64_t horizonMs = (uint64_t)numBins * resolutionMs;
+    if (group->periodMs < resolutionMs)
+    {
+        for (int bin = 0; bin < numBins; bin++)
+        {
+            binsBytes[bin] += bytes; // Published at every round
+        }
+        return;
+    }
+    for (uint64_t tMs = phaseMs; tMs < horizonMs; tMs += group->periodMs)
+    {
+        binsBytes[tMs / resolutionMs] += bytes;
+    }
+}
+
+static void getLoadPeak(const uint32_t *binsBytes, int numBins, uint32_t *peakBytes, uint64_t *sumSquares)
+{
+    *peakBytes = 0;
+    *sumSquares = 0;
+    for (int bin = 0; bin < numBins; bin++)
+    {
+        if (binsBytes[bin] > *peakBytes)
+            *peakBytes = binsBytes[bin];
+        *sumSquares += (uint64_t)binsBytes[bin] * binsBytes[bin];
+    }
+}
+
+// Queue the part of the key dictionary not queued yet in the current session, in as many events as needed. Each
+// event is {"v":"<version>","o":<id of the first key>,"n":<number of keys>,"k":[<keys>]}, where the id of a key is its
+// position in the whole list. Returns true if the whole dictionary is published.
+static bool publishKeyDictionary()
+{
+    if (keyDictionaryNumProps != numPropsCreated)
+    {
+        // New session, or properties added: new version, published from the beginning
+        keyDictionaryVersion = hashBytes(NULL, 0);
+        for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+        {
+            keyDictionaryVersion = continueHash(keyDictionaryVersion, propsCold->key[pIdx], strlen(propsCold->key[pIdx]) + 1); // Null char as separator
+        }
+        keyDictionaryNumProps = numPropsCreated;
+        keyDictionaryPublished = 0;
+        keyDictionaryQueued = 0;
+        keyDictionarySession++;
+    }
+
+    // Chunks are sent by the sender stage like the payloads, with the same retry policy
+    while (keyDictionaryQueued < numPropsCreated)
+    {
+        const int slotIdx = takeFreePublishSlot();
+        if (slotIdx < 0)
+        {
+            break;
+        }
+        PublishSlot_t *slot = &publishSlots[slotIdx];
+        PayloadWriter_t writer = {.buffer = slot->buffer, .length = 0, .size = JSON_BUFFER_LEN - 3}; // Room for "]}" and null char
+        writerPrintf(&writer, "{\"v\":\"%08" PRIx32 "\",\"o\":%d,\"n\":%d,\"k\":[", keyDictionaryVersion, keyDictionaryQueued, numPropsCreated);
+        int pIdx = keyDictionaryQueued;
+        for (; pIdx < numPropsCreated; pIdx++)
+        {
+            const size_t keyStart = writer.length;
+            const char *key = propsCold->key[pIdx];
+            if (!(pIdx == keyDictionaryQueued || writerPrintf(&writer, ",")) || !writerAppendJsonString(&writer, key, strlen(key)))
+            {
+                writer.length = keyStart;
+                writer.buffer[keyStart] = '\0';
+                break;
+            }
+        }
+        strcpy(writer.buffer + writer.length, "]}");
+        consumeBudget(writer.length + 2);
+        slot->dictionaryEnd = pIdx;
+        slot->dictionarySession = keyDictionarySession;
+        slot->retries = 0;
+        setPublishSlotState(slotIdx, PUBLISH_SLOT_QUEUED);
+        xQueueSend(sendQueue, &slotIdx, 0); // Never full: there is room for all the slots
+        keyDictionaryQueued = pIdx;
+    }
+    return keyDictionaryPublished == numPropsCreated;
+}
+
+// Serializer stage: serialize in a slot the properties to be published at this round with the given encoding, and
+// queue the payload for the sender stage. If no slot is free, the payloads already serialized are still being sent:
+// nothing is serialized, and the changed properties are published later with their latest value.
+static void serializePayload(Trackle_PropsEncoding_t encoding, const GroupDue_t *groupsDue, bool useKeyIds, int64_t nowUs)
+{
+    int slotIdx = takeFreePublishSlot();
+    if (slotIdx < 0 && senderTask.handle == NULL)
+    {
+        // Without sender task the single slot may hold the payload of another encoding of this round: send it first
+        sendQueuedPublishSlot();
+        collectPublishSlots();
+        slotIdx = takeFreePublishSlot();
+    }
+    if (slotIdx < 0)
+    {
+        return;
+    }
+    PublishSlot_t *slot = &publishSlots[slotIdx];
+    PayloadWriter_t writer = {.buffer = encoding == TRACKLE_PROPS_ENCODING_JSON ? slot->buffer : (char *)cborBuffer, .length = 0, .serializer = &serializers[encoding], .useKeyIds = useKeyIds};
+    writer.size = writer.serializer->size;
+    writer.startUs = nowUs;
+    writer.numAges = 0;
+    writer.serializer->begin(&writer);
+    if (timestampsMode == TRACKLE_PROPS_TIMESTAMPS_PROPERTY)
+    {
+        writer.size -= writer.serializer->agesLength;
+    }
+
+    // For each group due with this encoding...
+    for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
+    {
+        if (groupsDue[pgIdx] == GROUP_NOT_DUE || propGroups[pgIdx].encoding != encoding)
+        {
+            continue;
+        }
+        const bool onlyIfChanged = propGroups[pgIdx].onlyIfChanged || groupsDue[pgIdx] == GROUP_SETTLED;
+
+        // ... for each property in the group ...
+        for (int i = 0; i < propGroups[pgIdx].propsWithin; i++)
+        {
+            const int propIdx = propGroups[pgIdx].propsIndexes[i];
+
+            // ... if it's changed or it must be published anyway (and it's not already in the payload), add it to the payload.
+            if (!isPropInBitset(slot->members, propIdx) && isPropToPublish(propIdx, onlyIfChanged))
+            {
+                addPropToPayload(slot, &writer, propIdx);
+            }
+        }
+    }
+
+    if (encoding == propsEncoding)
+    {
+        // Urgent properties don't wait for their groups, and take with them the properties of the groups that are due.
+        if (urgentPending)
+        {
+            addUrgentPropsToPayload(slot, &writer, nowUs);
+        }
+
+        // Properties not published since the connection are added in chunks, after the ones of the groups.
+        if (resyncActive && isDeadlineReached(nowUs, resyncNextChunkUs))
+        {
+            addResyncChunkToPayload(slot, &writer, nowUs);
+        }
+    }
+
+    // If there is at least a property in the payload, queue it for the sender stage.
+    if (!isBitsetEmpty(slot->members))
+    {
+        consumeBudget(writer.serializer->end(&writer, slot->buffer));
+        nextPayloadSeq++;
+        slot->retries = 0;
+        setPublishSlotState(slotIdx, PUBLISH_SLOT_QUEUED);
+        xQueueSend(sendQueue, &slotIdx, 0); // Never full: there is room for all the slots
+    }
+}
+
+void trackleUtilsPropertiesRun(int64_t nowUs)
+{
+    collectPublishSlots();
+
+    const bool connected = trackleConnected(trackle_s);
+    if (connected && !wasConnected)
+    {
+        if (!everConnected || resyncConfig.onReconnect)
+        {
+            startResync(nowUs);
+        }
+        keyDictionaryNumProps = 0; // The dictionary is published again in every session
+    }
+    everConnected |= connected;
+    wasConnected = connected;
+
+    if (connected)
+    {
+        // Scheduler stage: groups timing and debounce are handled at every round, even when nothing can be serialized.
+        // Groups published on settle are also due as soon as one of their properties settles.
+        GroupDue_t groupsDue[TRACKLE_MAX_PROPGROUPS_NUM];
+        for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
+        {
+            PropGroup_t *group = &propGroups[pgIdx];
+            groupsDue[pgIdx] = scheduleGroup(group, nowUs) ? GROUP_DUE : GROUP_NOT_DUE;
+            for (int i = 0; groupsDue[pgIdx] == GROUP_DUE && i < group->propsWithin; i++)
+            {
+                applyDebounce(group->propsIndexes[i], nowUs);
+            }
+            if (groupsDue[pgIdx] == GROUP_NOT_DUE && group->publishOnSettle && isGroupSettled(group, nowUs))
+            {
+                groupsDue[pgIdx] = GROUP_SETTLED;
+            }
+            if (groupsDue[pgIdx] != GROUP_NOT_DUE)
+            {
+                group->latestPublishUs = nowUs;
+            }
+        }
+
+        // If the budget is exhausted nothing can be sent: nothing is serialized at this round (changed properties stay
+        // changed, and are published later with their latest value).
+        if (isBudgetAvailable(nowUs))
+        {
+            // Properties are referred to by id once the dictionary is published, except while resyncing
+            const bool useKeyIds = keyDictionaryEnabled && publishKeyDictionary() && !resyncActive;
+
+            // One payload for each encoding
+            for (int encoding = 0; encoding < PAYLOAD_ENCODINGS_NUM; encoding++)
+            {
+                if (encoding == TRACKLE_PROPS_ENCODING_JSON || cborBuffer != NULL)
+                {
+                    serializePayload(encoding, groupsDue, useKeyIds, nowUs);
+                }
+            }
+        }
+        else
+        {
+            publishStats.throttled++;
+        }
+        armSettleTimer(nowUs);
+    }
+
+    // Without sender task, payloads are sent right away and their results collected at once.
+    if (senderTask.handle == NULL)
+    {
+        sendQueuedPublishSlot();
+        collectPublishSlots();
+    }
+
+    persistLastPublishedValues(nowUs);
+}
+
+static void tracklePropertiesTaskCode(void *arg)
+{
+    const TickType_t period = propertiesTask.config.periodMs / portTICK_PERIOD_MS;
+    TickType_t deadline = xTaskGetTickCount();
+    trackleUtilsPropertiesBegin(trackleUtilsNowUs());
+    deadline += period;
+
+    for (;;)
+    {
+        // Urgent properties wake the task up before the deadline, that stays the same
+        if (!trackleUtilsTaskWaitUntil(deadline))
+        {
+            deadline += period;
+        }
+        const TrackleUtilsLoopStart_t loopStart = trackleUtilsTaskLoopBegin();
+        trackleUtilsPropertiesRun(trackleUtilsNowUs());
+        trackleUtilsTaskLoopEnd(&propertiesTask, loopStart);
+    }
+}
+
+static void tracklePropertiesSenderTaskCode(void *arg)
+{
+    for (;;)
+    {
+        int slotIdx;
+        if (xQueuePeek(sendQueue, &slotIdx, portMAX_DELAY) == pdTRUE)
+        {
+            const TrackleUtilsLoopStart_t loopStart = trackleUtilsTaskLoopBegin();
+            const bool goOn = sendQueuedPublishSlot();
+            trackleUtilsTaskLoopEnd(&senderTask, loopStart);
+            if (!goOn)
+            {
+                // Wait for the retry delay, checking the connection at every period
+                const uint32_t waitMs = trackleUtilsRetryGetWaitMs(&sendRetry, trackleUtilsNowMs());
+                const uint32_t delayMs = waitMs > 0 && waitMs < senderTask.config.periodMs ? waitMs : senderTask.config.periodMs;
+                vTaskDelay(delayMs / portTICK_PERIOD_MS + 1);
+            }
+        }
+    }
+}
+
+// Allocate the buffers of the first numSlots publish slots, and the queue of the slots to be sent.
+static bool enablePublishSlots(int numSlots)
+{
+    if (sendQueue == NULL)
+    {
+        sendQueue = xQueueCreate(PUBLISH_SLOTS_NUM, sizeof(int));
+        if (sendQueue == NULL)
+        {
+            return false;
+        }
+    }
+    for (; numPublishSlots < numSlots; numPublishSlots++)
+    {
+        publishSlots[numPublishSlots].buffer = trackleUtilsCalloc(TRACKLE_MEM_CLASS_BUFFERS, JSON_BUFFER_LEN, sizeof(char));
+        if (publishSlots[numPublishSlots].buffer == NULL)
+        {
+            return false;
+        }
+        publishSlots[numPublishSlots].state = PUBLISH_SLOT_FREE;
+    }
+    return true;
+}
+
+// Release the publish slots and the send queue, unless the sender task uses them.
+static void disablePublishSlots()
+{
+    if (senderTask.handle != NULL)
+    {
+        return;
+    }
+    for (; numPublishSlots > 0; numPublishSlots--)
+    {
+        trackleUtilsFree(publishSlots[numPublishSlots - 1].buffer);
+        publishSlots[numPublishSlots - 1].buffer = NULL;
+    }
+    if (sendQueue != NULL)
+    {
+        vQueueDelete(sendQueue);
+        sendQueue = NULL;
+    }
+}
+
+bool trackleUtilsPropertiesPrepare()
+{
+    if (enginePrepared)
+    {
+        ESP_LOGE(TAG, "Task already started.");
+        return false;
+    }
+    if (!enablePublishSlots(1))
+    {
+        ESP_LOGE(TAG, "Error in buffer allocation.");
+        disablePublishSlots();
+        return false;
+    }
+    enginePrepared = true;
+    return true;
+}
+
+void trackleUtilsPropertiesUnprepare()
+{
+    disablePublishSlots();
+    enginePrepared = false;
+}
+
+bool Trackle_Props_startTask()
+{
+    const Trackle_TaskConfig_t config = TRACKLE_PROPERTIES_TASK_CONFIG_DEFAULT();
+    return Trackle_Props_startTaskWithConfig(&config);
+}
+
+bool Trackle_Props_startTaskWithConfig(const Trackle_TaskConfig_t *config)
+{
+
+    ESP_LOGI(TAG, "Initializing...");
+
+    if (!trackleUtilsTaskIsConfigValid(config) || !trackleUtilsPropertiesPrepare())
+    {
+        return false;
+    }
+
+    // Task creation
+    if (trackleUtilsTaskStart(&propertiesTask, tracklePropertiesTaskCode, TRACKLE_PROPERTIES_TASK_NAME, config))
+    {
+        ESP_LOGI(TAG, "Task created successfully.");
+        return true;
+    }
+    ESP_LOGE(TAG, "Error in task creation.");
+    trackleUtilsPropertiesUnprepare();
+    return false;
+}
+
+bool Trackle_Props_getTaskStats(Trackle_TaskStats_t *stats)
+{
+    return trackleUtilsTaskGetStats(&propertiesTask, stats);
+}
+
+bool Trackle_Props_startSenderTask(const Trackle_TaskConfig_t *config)
+{
+    if (senderTask.handle != NULL)
+    {
+        ESP_LOGE(TAG, "Sender task already started.");
+        return false;
+    }
+    if (!enablePublishSlots(PUBLISH_SLOTS_NUM))
+    {
+        ESP_LOGE(TAG, "Error in buffer allocation.");
+        return false;
+    }
+    if (trackleUtilsTaskStart(&senderTask, tracklePropertiesSenderTaskCode, TRACKLE_PROPERTIES_SENDER_TASK_NAME, config))
+    {
+        ESP_LOGI(TAG, "Sender task created successfully.");
+        return true;
+    }
+    ESP_LOGE(TAG, "Error in sender task creation.");
+    return false;
+}
+
+bool Trackle_Props_getSenderTaskStats(Trackle_TaskStats_t *stats)
+{
+    return trackleUtilsTaskGetStats(&senderTask, stats);
+}
+
+bool Trackle_Props_setRetryPolicy(const Trackle_RetryPolicy_t *policy)
+{
+    if (policy == NULL || policy->multiplier == 0)
+    {
+        return false;
+    }
+    retryPolicy = *policy;
+    return true;
+}
+
+void Trackle_Props_getPublishStats(Trackle_PublishStats_t *stats)
+{
+    *stats = publishStats;
+}
+
+bool Trackle_Props_setBudget(const Trackle_PropsBudget_t *newBudget)
+{
+    if (newBudget == NULL)
+    {
+        return false;
+    }
+    budget = *newBudget;
+    return true;
+}
+
+bool Trackle_Props_setResyncConfig(const Trackle_PropsResyncConfig_t *config)
+{
+    if (config == NULL)
+    {
+        return false;
+    }
+    resyncConfig = *config;
+    return true;
+}
+
+bool Trackle_Props_enablePersistence(const char *nvsNamespace, uint32_t minWriteIntervalMs)
+{
+    if (persistenceEnabled)
+    {
+        return false;
+    }
+    const esp_err_t err = nvs_open(nvsNamespace, NVS_READWRITE, &persistenceHandle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error opening NVS namespace %s: %s", nvsNamespace, esp_err_to_name(err));
+        return false;
+    }
+    persistenceMinIntervalMs = minWriteIntervalMs;
+    persistenceLatestWriteUs = trackleUtilsNowUs();
+    restoreLastPublishedValues();
+    persistenceEnabled = true;
+    return true;
+}
+
+bool Trackle_PropGroups_spreadPhases(uint32_t resolutionMs)
+{
+    if (resolutionMs == 0 || numPropGroupsCreated == 0)
+    {
+        return resolutionMs != 0;
+    }
+    const int numBins = getLoadBinsNumber(resolutionMs);
+    uint32_t *binsBytes = trackleUtilsCalloc(TRACKLE_MEM_CLASS_BUFFERS, numBins, sizeof(uint32_t));
+    if (binsBytes == NULL)
+    {
+        return false;
+    }
+
+    // Groups that can't be moved are placed first, then the others from the largest, each at the phase that
+    // minimizes the peak of the load, and then the sum of the squares of the load (so the peak-to-average ratio).
+    uint32_t groupBytes[TRACKLE_MAX_PROPGROUPS_NUM];
+    bool placed[TRACKLE_MAX_PROPGROUPS_NUM] = {false};
+    for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
+    {
+        PropGroup_t *group = &propGroups[pgIdx];
+        groupBytes[pgIdx] = estimateGroupBytes(group);
+        if (getGroupCold(group)->alignToWallClock || group->periodMs < resolutionMs * 2)
+        {
+            getGroupCold(group)->phaseMs = 0;
+            addGroupLoad(binsBytes, numBins, resolutionMs, group, 0, groupBytes[pgIdx]);
+            placed[pgIdx] = true;
+        }
+    }
+    for (;;)
+    {
+        int largestIdx = -1;
+        for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
+        {
+            if (!placed[pgIdx] && (largestIdx < 0 || groupBytes[pgIdx] > groupBytes[largestIdx]))
+                largestIdx = pgIdx;
+        }
+        if (largestIdx < 0)
+        {
+            break;
+        }
+        PropGroup_t *group = &propGroups[largestIdx];
+        const uint32_t numPhases = group->periodMs / resolutionMs;
+        const uint32_t phaseStep = (numPhases + PHASE_MAX_CANDIDATES - 1) / PHASE_MAX_CANDIDATES * resolutionMs;
+        uint32_t bestPhaseMs = 0, bestPeakBytes = UINT32_MAX;
+        uint64_t bestSumSquares = UINT64_MAX;
+        for (uint32_t phaseMs = 0; phaseMs < group->periodMs; phaseMs += phaseStep)
+        {
+            uint32_t peakBytes;
+            uint64_t sumSquares;
+            addGroupLoad(binsBytes, numBins, resolutionMs, group, phaseMs, groupBytes[largestIdx]);
+            getLoadPeak(binsBytes, numBins, &peakBytes, &sumSquares);
+            addGroupLoad(binsBytes, numBins, resolutionMs, group, phaseMs, -(int32_t)groupBytes[largestIdx]);
+            if (peakBytes < bestPeakBytes || (peakBytes == bestPeakBytes && sumSquares < bestSumSquares))
+            {
+                bestPhaseMs = phaseMs;
+                bestPeakBytes = peakBytes;
+                bestSumSquares = sumSquares;
+            }
+        }
+        getGroupCold(group)->phaseMs = bestPhaseMs;
+        addGroupLoad(binsBytes, numBins, resolutionMs, group, bestPhaseMs, groupBytes[largestIdx]);
+        placed[largestIdx] = true;
+    }
+
+    trackleUtilsFree(binsBytes);
+    return true;
+}
+
+bool Trackle_PropGroup_getProfile(Trackle_PropGroupID_t propGroupId, Trackle_PropGroupProfile_t *profile)
+{
+    const int propGroupIndex = propGroupId - 1;
+    if (propGroupIndex < 0 || propGroupIndex >= numPropGroupsCreated || profile == NULL)
+    {
+        return false;
+    }
+    const PropGroup_t *group = &propGroups[propGroupIndex];
+    profile->phaseMs = getGroupCold(group)->phaseMs;
+    profile->predictedBytes = estimateGroupBytes(group);
+    profile->bytesPerSecond = group->periodMs > 0 ? (uint64_t)profile->predictedBytes * 1000 / group->periodMs : 0;
+    return true;
+}
+
+uint32_t Trackle_PropGroups_getPredictedPeakBytes(uint32_t resolutionMs)
+{
+    if (resolutionMs == 0)
+    {
+        return 0;
+    }
+    const int numBins = getLoadBinsNumber(resolutionMs);
+    uint32_t *binsBytes = trackleUtilsCalloc(TRACKLE_MEM_CLASS_BUFFERS, numBins, sizeof(uint32_t));
+    if (binsBytes == NULL)
+    {
+        return 0;
+    }
+    for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
+    {
+        addGroupLoad(binsBytes, numBins, resolutionMs, &propGroups[pgIdx], propGroupsCold[pgIdx].phaseMs, estimateGroupBytes(&propGroups[pgIdx]));
+    }
+    uint32_t peakBytes;
+    uint64_t sumSquares;
+    getLoadPeak(binsBytes, numBins, &peakBytes, &sumSquares);
+    trackleUtilsFree(binsBytes);
+    return peakBytes;
+}
+
+int Trackle_Props_getUnsyncedNumber()
+{
+    int unsynced = 0;
+    for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+    {
+        if (isPropToResync(pIdx))
+        {
+            unsynced++;
+        }
+    }
+    return unsynced;
+}
+
+int Trackle_Props_getNumber()
+{
+    return numPropsCreated;
+}
+
+// Validate name and initialize the fields common to all the kinds of properties in the next free slot.
+// Returns the index of the slot, or -1 on failure. The slot is taken only when numPropsCreated is incremented.
+static int initNewProp(const char *name)
+{
+    if (propsCold == NULL)
+    {
+        propsCold = trackleUtilsCalloc(TRACKLE_MEM_CLASS_DESCRIPTORS, 1, sizeof(PropsCold_t));
+        if (propsCold == NULL)
+        {
+            return -1;
+        }
+    }
+    if (numPropsCreated >= TRACKLE_MAX_PROPS_NUM || strlen(name) >= TRACKLE_MAX_PROP_NAME_LENGTH)
+    {
+        return -1;
+    }
+    for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+    {
+        if (strcmp(name, propsCold->key[pIdx]) == 0)
+        {
+            return -1;
+        }
+    }
+    const int newPropIndex = numPropsCreated;
+    strcpy(propsCold->key[newPropIndex], name);
+    propsHot.lastPubValue[newPropIndex] = defaultValue;
+    propsHot.setValue[newPropIndex] = defaultValue;
+    propsHot.flags[newPropIndex] = defaultChanged ? PROP_FLAG_CHANGED : 0;
+    propsHot.config[newPropIndex] = 0;
+    propsHot.kind[newPropIndex] = PROP_KIND_NUMBER;
+    propsHot.disabled[newPropIndex] = false;
+    propsHot.debouncing[newPropIndex] = false;
+    propsHot.latestSetTimeUs[newPropIndex] = 0;
+    propsHot.debounceDelayUs[newPropIndex] = 0;
+    propsCold->scale[newPropIndex] = 1;
+    propsCold->numDecimals[newPropIndex] = 0;
+    propsCold->sign[newPropIndex] = false;
+    propsCold->lastPubStringValue[newPropIndex] = NULL;
+    propsCold->setStringValue[newPropIndex] = NULL;
+    propsCold->spareStringValue[newPropIndex] = NULL;
+    propsCold->setStringLength[newPropIndex] = 0;
+    propsCold->lastPubStringLength[newPropIndex] = 0;
+    propsCold->stringValueMaxLength[newPropIndex] = 0;
+    propsCold->priority[newPropIndex] = TRACKLE_PROP_PRIORITY_NORMAL;
+    propsCold->labels[newPropIndex] = NULL;
+    propsCold->numLabels[newPropIndex] = 0;
+    propsCold->format[newPropIndex] = TRACKLE_BITFIELD_FORMAT_MASK;
+    propsCold->quotedLabels[newPropIndex] = NULL;
+    return newPropIndex;
+}
+
+Trackle_PropID_t Trackle_Prop_create(const char *name, uint16_t scale, uint8_t numDecimals, bool sign)
+{
+    const int newPropIndex = initNewProp(name);
+    if (newPropIndex < 0)
+    {
+        return Trackle_PropID_ERROR;
+    }
+    propsCold->scale[newPropIndex] = scale;
+    propsCold->sign[newPropIndex] = sign;
+    propsCold->numDecimals[newPropIndex] = numDecimals;
+    numPropsCreated++;
+    return newPropIndex + 1; // Convert internal property index to property ID by incrementing it.
+}
+
+Trackle_PropID_t Trackle_Prop_createString(const char *name, int maxLength)
+{
+    const int newPropIndex = initNewProp(name);
+    if (newPropIndex < 0)
+    {
+        return Trackle_PropID_ERROR;
+    }
+    if (maxLength < 0)
+    {
+        return Trackle_PropID_ERROR;
+    }
+    // Both the buffers in a single block, so that nothing is left behind on failure
+    const size_t bufferSize = (maxLength + 1 + 3) & ~(size_t)3; // +1 for null character, rounded to keep the second buffer aligned
+    char *buffers = trackleUtilsPoolAlloc(2 * bufferSize);
+    if (buffers == NULL)
+    {
+        return Trackle_PropID_ERROR;
+    }
+    propsCold->lastPubStringValue[newPropIndex] = buffers;
+    propsCold->setStringValue[newPropIndex] = buffers + bufferSize;
+    propsCold->stringValueMaxLength[newPropIndex] = maxLength;
+    propsHot.kind[newPropIndex] = PROP_KIND_STRING;
+    propsHot.setValue[newPropIndex] = hashBytes(EMPTY_STRING, 0);
+    propsHot.lastPubValue[newPropIndex] = propsHot.setValue[newPropIndex];
+    numPropsCreated++;
+    return newPropIndex + 1; // Convert internal property index to property ID by incrementing it.
+}
+
+Trackle_PropID_t Trackle_Prop_createFloat(const char *name, uint8_t numDecimals)
+{
+    const int newPropIndex = initNewProp(name);
+    if (newPropIndex < 0)
+    {
+        return Trackle_PropID_ERROR;
+    }
+    propsHot.kind[newPropIndex] = PROP_KIND_FLOAT;
+    propsHot.setValue[newPropIndex] = floatToBits((float)defaultValue);
+    propsHot.lastPubValue[newPropIndex] = propsHot.setValue[newPropIndex];
+    propsCold->numDecimals[newPropIndex] = numDecimals;
+    numPropsCreated++;
+    return newPropIndex + 1; // Convert internal property index to property ID by incrementing it.
+}
+
+static Trackle_PropID_t createWideProp(const char *name, PropKind_t kind)
+{
+    if (wideValues == NULL)
+    {
+        wideValues = trackleUtilsCalloc(TRACKLE_MEM_CLASS_VALUES, 1, sizeof(WideValues_t));
+        if (wideValues == NULL)
+        {
+            return Trackle_PropID_ERROR;
+        }
+    }
+    const int newPropIndex = numWidePropsCreated < TRACKLE_MAX_WIDE_PROPS_NUM ? initNewProp(name) : -1;
+    if (newPropIndex < 0)
+    {
+        return Trackle_PropID_ERROR;
+    }
+    const int wideIndex = numWidePropsCreated++;
+    wideValues->setValue[wideIndex] = defaultValue;
+    wideValues->lastPubValue[wideIndex] = defaultValue;
+    propsHot.kind[newPropIndex] = kind;
+    propsHot.setValue[newPropIndex] = wideIndex;
+    propsHot.lastPubValue[newPropIndex] = wideIndex;
+    numPropsCreated++;
+    return newPropIndex + 1; // Convert internal property index to property ID by incrementing it.
+}
+
+Trackle_PropID_t Trackle_Prop_createInt64(const char *name)
+{
+    return createWideProp(name, PROP_KIND_INT64);
+}
+
+Trackle_PropID_t Trackle_Prop_createUint64(const char *name)
+{
+    return createWideProp(name, PROP_KIND_UINT64);
+}
+
+Trackle_PropID_t Trackle_Prop_createBitfield(const char *name, const char *const *flagNames, uint8_t numFlags, Trackle_BitfieldFormat_t format)
+{
+    if (numFlags == 0 || numFlags > TRACKLE_MAX_BITFIELD_FLAGS || (format == TRACKLE_BITFIELD_FORMAT_NAMED && flagNames == NULL) ||
+        (format != TRACKLE_BITFIELD_FORMAT_MASK && format != TRACKLE_BITFIELD_FORMAT_NAMED))
+    {
+        return Trackle_PropID_ERROR;
+    }
+    const int newPropIndex = initNewProp(name);
+    if (newPropIndex < 0)
+    {
+        return Trackle_PropID_ERROR;
+    }
+    propsHot.kind[newPropIndex] = PROP_KIND_BITFIELD;
+    propsCold->labels[newPropIndex] = flagNames;
+    propsCold->numLabels[newPropIndex] = numFlags;
+    propsCold->format[newPropIndex] = format;
+    numPropsCreated++;
+    return newPropIndex + 1; // Convert internal property index to property ID by incrementing it.
+}
+
+// Wake up the task running the engine, with a single notification, if urgent properties were set (to publish them
+// without waiting for their groups) or if a property of a group published on settle settles before the settle timer
+// expires (so that the timer is armed for it). Properties set again later only delay their expiry: the engine arms the
+// timer again when it expires.
+static void wakeUpIfPublishedEarly(bool urgent, int64_t settleUs)
+{
+    if (urgent)
+    {
+        urgentPending = true;
+    }
+    portENTER_CRITICAL(&timesLock);
+    const bool earlier = settleUs < settleTimerDeadlineUs;
+    if (earlier)
+    {
+        settleTimerDeadlineUs = settleUs; // Until the engine arms the timer, later properties don't wake it up again
+    }
+    portEXIT_CRITICAL(&timesLock);
+    if ((urgent || earlier) && engineTaskHandle != NULL)
+    {
+        xTaskNotifyGive(engineTaskHandle);
+    }
+}
+
+// Earliest between settleUs and the time the debounce of the property just set expires, if it's published on settle.
+static int64_t getEarliestSettleUs(int propIndex, int64_t settleUs)
+{
+    if (!(propsHot.config[propIndex] & PROP_CONFIG_SETTLE))
+    {
+        return settleUs;
+    }
+    const int64_t propSettleUs = getSettleTimeUs(propIndex);
+    return propSettleUs < settleUs ? propSettleUs : settleUs;
+}
+
+// Wake up the task running the engine if the property just set must be published before its groups are due.
+static void notifyIfPublishedEarly(int propIndex)
+{
+    wakeUpIfPublishedEarly((propsHot.config[propIndex] & PROP_CONFIG_URGENT) != 0, getEarliestSettleUs(propIndex, INT64_MAX));
+}
+
+Trackle_PropID_t Trackle_Prop_createEnum(const char *name, const char *const *labels, uint8_t numLabels)
+{
+    if (labels == NULL || numLabels == 0)
+    {
+        return Trackle_PropID_ERROR;
+    }
+    const int newPropIndex = initNewProp(name);
+    if (newPropIndex < 0)
+    {
+        return Trackle_PropID_ERROR;
+    }
+
+    // Pointers to the quoted labels, followed by the quoted (and escaped) labels themselves, in a single block
+    size_t size = numLabels * sizeof(char *);
+    for (int label = 0; label < numLabels; label++)
+    {
+        size += trackleUtilsJsonEscapedLength(labels[label], strlen(labels[label])) + 3; // Quotes and null char
+    }
+    char **quotedLabels = trackleUtilsPoolAlloc(size);
+    if (quotedLabels == NULL)
+    {
+        return Trackle_PropID_ERROR;
+    }
+    char *quotedLabel = (char *)(quotedLabels + numLabels);
+    for (int label = 0; label < numLabels; label++)
+    {
+        size_t length = 1;
+        quotedLabels[label] = quotedLabel;
+        quotedLabel[0] = '"';
+        trackleUtilsJsonAppendEscaped(quotedLabel, &length, SIZE_MAX, labels[label], strlen(labels[label])); // Room computed above
+        quotedLabel[length++] = '"';
+        quotedLabel[length++] = '\0';
+        quotedLabel += length;
+    }
+
+    propsHot.kind[newPropIndex] = PROP_KIND_ENUM;
+    propsHot.setValue[newPropIndex] = 0;
+    propsHot.lastPubValue[newPropIndex] = 0;
+    propsCold->labels[newPropIndex] = labels;
+    propsCold->numLabels[newPropIndex] = numLabels;
+    propsCold->quotedLabels[newPropIndex] = quotedLabels;
+    numPropsCreated++;
+    return newPropIndex + 1; // Convert internal property index to property ID by incrementing it.
+}
+
+Trackle_PropID_t Trackle_Prop_createSeries(const char *name, const Trackle_SeriesConfig_t *config)
+{
+    if (config == NULL || config->capacity == 0 || config->intervalMs == 0 || config->decimation == 0 ||
+        (config->format != TRACKLE_SERIES_FORMAT_DELTA_BASE64 && config->format != TRACKLE_SERIES_FORMAT_ARRAY))
+    {
+        return Trackle_PropID_ERROR;
+    }
+    if (series == NULL)
+    {
+        series = trackleUtilsCallocInternal(TRACKLE_MAX_SERIES_PROPS_NUM, sizeof(Series_t));
+        seriesCold = trackleUtilsCalloc(TRACKLE_MEM_CLASS_DESCRIPTORS, TRACKLE_MAX_SERIES_PROPS_NUM, sizeof(SeriesCold_t));
+        if (series == NULL || seriesCold == NULL)
+        {
+            trackleUtilsFree(series);
+            trackleUtilsFree(seriesCold);
+            series = NULL;
+            seriesCold = NULL;
+            return Trackle_PropID_ERROR;
+        }
+    }
+    const int newPropIndex = numSeriesCreated < TRACKLE_MAX_SERIES_PROPS_NUM ? initNewProp(name) : -1;
+    if (newPropIndex < 0)
+    {
+        return Trackle_PropID_ERROR;
+    }
+    int32_t *samples = trackleUtilsPoolAlloc(config->capacity * sizeof(int32_t));
+    if (samples == NULL)
+    {
+        return Trackle_PropID_ERROR;
+    }
+
+    const int seriesIndex = numSeriesCreated++;
+    Series_t *ring = &series[seriesIndex];
+    memset(ring, 0, sizeof(Series_t));
+    ring->samples = samples;
+    ring->capacity = config->capacity;
+    ring->decimation = config->decimation;
+    seriesCold[seriesIndex].format = config->format;
+    seriesCold[seriesIndex].intervalMs = config->intervalMs * config->decimation;
+    propsHot.kind[newPropIndex] = PROP_KIND_SERIES;
+    propsHot.setValue[newPropIndex] = seriesIndex;
+    propsHot.lastPubValue[newPropIndex] = seriesIndex;
+    numPropsCreated++;
+    return newPropIndex + 1; // Convert internal property index to property ID by incrementing it.
+}
+
+// Start the debounce of a property whose value was just set.
+static void markPropSet(int propIndex, int64_t nowUs)
+{
+    writeSetTimeUs(propIndex, nowUs);
+    propsHot.debouncing[propIndex] = true;
+    propsHot.txnId[propIndex] = 0;
+}
+
+// Set the value of a property with an int32 value, that must be different from the current one.
+static void setPropValue(int propIndex, int32_t newValue, int64_t nowUs)
+{
+    propsHot.setValue[propIndex] = newValue;
+    markPropSet(propIndex, nowUs);
+}
+
+bool Trackle_Prop_update(Trackle_PropID_t propID, int newValue)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated && isValidInt32Value(propIndex, newValue))
+    {
+        if (propsHot.setValue[propIndex] != newValue)
+        {
+            ESP_LOGD(TAG, "PROP CHANGED ---- %s: old: %" PRIi32 ", new: %d", propsCold->key[propIndex], propsHot.setValue[propIndex], newValue);
+            setPropValue(propIndex, newValue, trackleUtilsNowUs());
+            notifyIfPublishedEarly(propIndex);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Trackle_Prop_updateString(Trackle_PropID_t propID, const char *newValue)
+{
+    return newValue != NULL && Trackle_Prop_updateStringWithLength(propID, newValue, strlen(newValue));
+}
+
+bool Trackle_Prop_updateStringWithLength(Trackle_PropID_t propID, const char *newValue, size_t length)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex < 0 || propIndex >= numPropsCreated || propsHot.kind[propIndex] != PROP_KIND_STRING || newValue == NULL)
+    {
+        return false;
+    }
+    if (length > (size_t)propsCold->stringValueMaxLength[propIndex])
+    {
+        length = propsCold->stringValueMaxLength[propIndex];
+    }
+    const uint32_t hash = hashBytes(newValue, length);
+    const int64_t nowUs = trackleUtilsNowUs();
+    portENTER_CRITICAL(&valuesLock);
+    if ((uint32_t)propsHot.setValue[propIndex] == hash && propsCold->setStringLength[propIndex] == length &&
+        memcmp(propsCold->setStringValue[propIndex], newValue, length) == 0)
+    {
+        portEXIT_CRITICAL(&valuesLock);
+        return false;
+    }
+    if (propsCold->setStringValue[propIndex] == propsCold->lastPubStringValue[propIndex])
+    {
+        // The buffer holds the published value too: write in the spare one
+        propsCold->setStringValue[propIndex] = propsCold->spareStringValue[propIndex];
+        propsCold->spareStringValue[propIndex] = NULL;
+    }
+    char *setStringValue = propsCold->setStringValue[propIndex];
+    memcpy(setStringValue, newValue, length);
+    setStringValue[length] = '\0';
+    propsCold->setStringLength[propIndex] = length;
+    propsHot.setValue[propIndex] = hash;
+    markPropSet(propIndex, nowUs);
+    portEXIT_CRITICAL(&valuesLock);
+
+    ESP_LOGD(TAG, "PROP CHANGED ---- %s: new: %s", propsCold->key[propIndex], setStringValue);
+    notifyIfPublishedEarly(propIndex);
+    return true;
+}
+
+bool Trackle_Prop_updateFloat(Trackle_PropID_t propID, float newValue)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated && propsHot.kind[propIndex] == PROP_KIND_FLOAT)
+    {
+        const int32_t newBits = floatToBits(newValue);
+        if (propsHot.setValue[propIndex] != newBits)
+        {
+            ESP_LOGD(TAG, "PROP CHANGED ---- %s: old: %f, new: %f", propsCold->key[propIndex], (double)floatFromBits(propsHot.setValue[propIndex]), (double)newValue);
+            setPropValue(propIndex, newBits, trackleUtilsNowUs());
+            notifyIfPublishedEarly(propIndex);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool updateWideProp(Trackle_PropID_t propID, PropKind_t kind, int64_t newValue)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex < 0 || propIndex >= numPropsCreated || propsHot.kind[propIndex] != kind)
+    {
+        return false;
+    }
+    const int64_t nowUs = trackleUtilsNowUs();
+    portENTER_CRITICAL(&valuesLock);
+    const bool changed = wideValues->setValue[propsHot.setValue[propIndex]] != newValue;
+    if (changed)
+    {
+        wideValues->setValue[propsHot.setValue[propIndex]] = newValue;
+        markPropSet(propIndex, nowUs);
+    }
+    portEXIT_CRITICAL(&valuesLock);
+    if (changed)
+    {
+        ESP_LOGD(TAG, "PROP CHANGED ---- %s: new: %" PRIi64, propsCold->key[propIndex], newValue);
+        notifyIfPublishedEarly(propIndex);
+    }
+    return changed;
+}
+
+bool Trackle_Prop_updateInt64(Trackle_PropID_t propID, int64_t newValue)
+{
+    return updateWideProp(propID, PROP_KIND_INT64, newValue);
+}
+
+bool Trackle_Prop_updateUint64(Trackle_PropID_t propID, uint64_t newValue)
+{
+    return updateWideProp(propID, PROP_KIND_UINT64, (int64_t)newValue);
+}
+
+bool Trackle_Prop_setBit(Trackle_PropID_t propID, uint8_t bit, bool value)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex < 0 || propIndex >= numPropsCreated || propsHot.kind[propIndex] != PROP_KIND_BITFIELD || bit >= propsCold->numLabels[propIndex])
+    {
+        return false;
+    }
+    const uint32_t bitMask = (uint32_t)1 << bit;
+    const int64_t nowUs = trackleUtilsNowUs();
+    portENTER_CRITICAL(&valuesLock);
+    const uint32_t mask = (uint32_t)propsHot.setValue[propIndex];
+    const uint32_t newMask = value ? mask | bitMask : mask & ~bitMask;
+    if (newMask != mask)
+    {
+        setPropValue(propIndex, (int32_t)newMask, nowUs);
+    }
+    portEXIT_CRITICAL(&valuesLock);
+    if (newMask != mask)
+    {
+        notifyIfPublishedEarly(propIndex);
+    }
+    return newMask != mask;
+}
+
+size_t Trackle_Prop_updateMany(const Trackle_PropID_t *propIDs, const int32_t *newValues, size_t n)
+{
+    if (propIDs == NULL || newValues == NULL)
+    {
+        return 0;
+    }
+    const int64_t nowUs = trackleUtilsNowUs();
+    size_t numChanged = 0;
+    uint8_t changedConfig = 0;
+    int64_t settleUs = INT64_MAX;
+    for (size_t u = 0; u < n; u++)
+    {
+        const int propIndex = propIDs[u] - 1; // Convert property ID to internal property index by decrementing it.
+        if (propIndex >= 0 && propIndex < numPropsCreated && isValidInt32Value(propIndex, newValues[u]) && propsHot.setValue[propIndex] != newValues[u])
+        {
+            setPropValue(propIndex, newValues[u], nowUs);
+            changedConfig |= propsHot.config[propIndex];
+            settleUs = getEarliestSettleUs(propIndex, settleUs);
+            numChanged++;
+        }
+    }
+    ESP_LOGD(TAG, "PROPS CHANGED ---- %u of %u", (unsigned)numChanged, (unsigned)n);
+    wakeUpIfPublishedEarly((changedConfig & PROP_CONFIG_URGENT) != 0, settleUs);
+    return numChanged;
+}
+
+size_t Trackle_Prop_updateRange(Trackle_PropID_t firstPropID, const int32_t *newValues, size_t n)
+{
+    const int firstIndex = firstPropID - 1; // Convert property ID to internal property index by decrementing it.
+    if (newValues == NULL || firstIndex < 0 || firstIndex > numPropsCreated || n > (size_t)(numPropsCreated - firstIndex))
+    {
+        return 0;
+    }
+    const int64_t nowUs = trackleUtilsNowUs();
+    size_t numChanged = 0;
+    uint8_t changedConfig = 0;
+    int64_t settleUs = INT64_MAX;
+    for (size_t u = 0; u < n; u++)
+    {
+        const int propIndex = firstIndex + u;
+        if (isValidInt32Value(propIndex, newValues[u]) && propsHot.setValue[propIndex] != newValues[u])
+        {
+            setPropValue(propIndex, newValues[u], nowUs);
+            changedConfig |= propsHot.config[propIndex];
+            settleUs = getEarliestSettleUs(propIndex, settleUs);
+            numChanged++;
+        }
+    }
+    ESP_LOGD(TAG, "PROPS CHANGED ---- %u of %u from %s", (unsigned)numChanged, (unsigned)n, n > 0 ? propsCold->key[firstIndex] : "");
+    wakeUpIfPublishedEarly((changedConfig & PROP_CONFIG_URGENT) != 0, settleUs);
+    return numChanged;
+}
+
+bool Trackle_Prop_addSample(Trackle_PropID_t propID, int32_t sample)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex < 0 || propIndex >= numPropsCreated || propsHot.kind[propIndex] != PROP_KIND_SERIES)
+    {
+        return false;
+    }
+    Series_t *ring = &series[propsHot.setValue[propIndex]];
+    const int64_t nowUs = trackleUtilsNowUs();
+    bool buffered = false;
+    bool dropped = false;
+    portENTER_CRITICAL(&valuesLock);
+    ring->decimationSum += sample;
+    if (++ring->decimationCount >= ring->decimation)
+    {
+        // Average of the samples added since the latest buffered one, rounded to nearest
+        const int64_t half = ring->decimation / 2;
+        const int64_t sum = ring->decimationSum;
+        dropped = ring->count >= ring->capacity;
+        if (!dropped)
+        {
+            ring->samples[(ring->first + ring->count) % ring->capacity] = (int32_t)((sum >= 0 ? sum + half : sum - half) / ring->decimation);
+            ring->count++;
+            ring->latestSampleUs = nowUs;
+            writeSetTimeUs(propIndex, nowUs);
+            buffered = true;
+        }
+        ring->decimationSum = 0;
+        ring->decimationCount = 0;
+    }
+    portEXIT_CRITICAL(&valuesLock);
+    if (buffered)
+    {
+        notifyIfPublishedEarly(propIndex);
+    }
+    return !dropped;
+}
+
+void Trackle_PropTxn_begin(Trackle_PropTxn_t *txn)
+{
+    txn->numUpdates = 0;
+}
+
+bool Trackle_PropTxn_update(Trackle_PropTxn_t *txn, Trackle_PropID_t propID, int32_t newValue)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (txn == NULL || propIndex < 0 || propIndex >= numPropsCreated || !isValidInt32Value(propIndex, newValue))
+    {
+        return false;
+    }
+    for (int u = 0; u < txn->numUpdates; u++)
+    {
+        if (txn->propIds[u] == propID)
+        {
+            txn->values[u] = newValue; // Latest staged value wins
+            return true;
+        }
+    }
+    if (txn->numUpdates >= TRACKLE_PROP_TXN_MAX_UPDATES)
+    {
+        return false;
+    }
+    txn->propIds[txn->numUpdates] = propID;
+    txn->values[txn->numUpdates] = newValue;
+    txn->numUpdates++;
+    return true;
+}
+
+bool Trackle_PropTxn_commit(Trackle_PropTxn_t *txn)
+{
+    if (txn == NULL || txn->numUpdates == 0)
+    {
+        return false;
+    }
+    const int64_t nowUs = trackleUtilsNowUs();
+    bool urgent = false;
+    int64_t settleUs = INT64_MAX;
+    portENTER_CRITICAL(&txnLock);
+    portENTER_CRITICAL(&valuesLock); // Bits of bitfields are also set one at a time, under valuesLock
+    latestTxnId = latestTxnId == UINT16_MAX ? 1 : latestTxnId + 1;
+    for (int u = 0; u < txn->numUpdates; u++)
+    {
+        const int propIndex = txn->propIds[u] - 1;
+        if (propsHot.setValue[propIndex] != txn->values[u])
+        {
+            writeSetTimeUs(propIndex, nowUs);
+            propsHot.debouncing[propIndex] = true;
+            propsHot.setValue[propIndex] = txn->values[u];
+            urgent |= (propsHot.config[propIndex] & PROP_CONFIG_URGENT) != 0;
+            settleUs = getEarliestSettleUs(propIndex, settleUs);
+        }
+        propsHot.txnId[propIndex] = latestTxnId;
+    }
+    portEXIT_CRITICAL(&valuesLock);
+    portEXIT_CRITICAL(&txnLock);
+    ESP_LOGD(TAG, "PROP TXN COMMITTED ---- %d updates", txn->numUpdates);
+
+    wakeUpIfPublishedEarly(urgent, settleUs);
+    txn->numUpdates = 0;
+    return true;
+}
+
+bool Trackle_Prop_setDisabled(Trackle_PropID_t propID, bool isDisabled)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated)
+    {
+        propsHot.disabled[propIndex] = isDisabled;
+        return true;
+    }
+    return false;
+}
+
+bool Trackle_Prop_setDebounceDelay(Trackle_PropID_t propID, uint32_t debounceDelayMs)
+{
+    return Trackle_Prop_setDebounceDelayUs(propID, (uint64_t)debounceDelayMs * 1000);
+}
+
+bool Trackle_Prop_setDebounceDelayUs(Trackle_PropID_t propID, uint64_t debounceDelayUs)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated && debounceDelayUs <= INT64_MAX)
+    {
+        portENTER_CRITICAL(&timesLock);
+        propsHot.debounceDelayUs[propIndex] = (int64_t)debounceDelayUs;
+        portEXIT_CRITICAL(&timesLock);
+        return true;
+    }
+    return false;
+}
+
+bool Trackle_Prop_setPriority(Trackle_PropID_t propID, Trackle_PropPriority_t priority)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated && priority >= TRACKLE_PROP_PRIORITY_LOW && priority <= TRACKLE_PROP_PRIORITY_URGENT)
+    {
+        propsCold->priority[propIndex] = priority;
+        if (priority == TRACKLE_PROP_PRIORITY_URGENT)
+            propsHot.config[propIndex] |= PROP_CONFIG_URGENT;
+        else
+            propsHot.config[propIndex] &= ~PROP_CONFIG_URGENT;
+        return true;
+    }
+    return false;
+}
+
+bool Trackle_Prop_isDisabled(Trackle_PropID_t propID)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated)
+    {
+        return propsHot.disabled[propIndex];
+    }
+    return false;
+}
+
+const char *Trackle_Prop_getKey(Trackle_PropID_t propID)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated)
+    {
+        return propsCold->key[propIndex];
+    }
+    return EMPTY_STRING;
+}
+
+int32_t Trackle_Prop_getValue(Trackle_PropID_t propID)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated && !isWideProp(propIndex) && propsHot.kind[propIndex] != PROP_KIND_FLOAT &&
+        propsHot.kind[propIndex] != PROP_KIND_SERIES)
+    {
+        return propsHot.setValue[propIndex];
+    }
+    return -1;
+}
+
+float Trackle_Prop_getFloat(Trackle_PropID_t propID)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated && propsHot.kind[propIndex] == PROP_KIND_FLOAT)
+    {
+        return floatFromBits(propsHot.setValue[propIndex]);
+    }
+    return NAN;
+}
+
+int64_t Trackle_Prop_getInt64(Trackle_PropID_t propID)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated && propsHot.kind[propIndex] == PROP_KIND_INT64)
+    {
+        return readSetValue(propIndex);
+    }
+    return -1;
+}
+
+uint64_t Trackle_Prop_getUint64(Trackle_PropID_t propID)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated && propsHot.kind[propIndex] == PROP_KIND_UINT64)
+    {
+        return (uint64_t)readSetValue(propIndex);
+    }
+    return 0;
+}
+
+const char *Trackle_Prop_getEnumLabel(Trackle_PropID_t propID)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated && propsHot.kind[propIndex] == PROP_KIND_ENUM)
+    {
+        return propsCold->labels[propIndex][propsHot.setValue[propIndex]];
+    }
+    return EMPTY_STRING;
+}
+
+bool Trackle_Prop_getBit(Trackle_PropID_t propID, uint8_t bit)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated && propsHot.kind[propIndex] == PROP_KIND_BITFIELD && bit < propsCold->numLabels[propIndex])
+    {
+        return ((uint32_t)propsHot.setValue[propIndex] >> bit) & 1;
+    }
+    return false;
 }
 
 bool Trackle_Prop_getStringValue(Trackle_PropID_t propID, char *retValue, int retValueMaxLen)
@@ -457,9 +3203,9 @@ bool Trackle_Prop_getStringValue(Trackle_PropID_t propID, char *retValue, int re
     const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
     if (propIndex >= 0 && propIndex < numPropsCreated)
     {
-        if (props[propIndex].setStringValue != NULL)
+        if (propsHot.kind[propIndex] == PROP_KIND_STRING)
         {
-            strncpy(retValue, props[propIndex].setStringValue, retValueMaxLen);
+            strncpy(retValue, propsCold->setStringValue[propIndex], retValueMaxLen);
             retValue[retValueMaxLen] = '\0';
             return true;
         }
@@ -472,7 +3218,7 @@ uint16_t Trackle_Prop_getScale(Trackle_PropID_t propID)
     const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
     if (propIndex >= 0 && propIndex < numPropsCreated)
     {
-        return props[propIndex].scale;
+        return propsCold->scale[propIndex];
     }
     return 0;
 }
@@ -482,7 +3228,7 @@ uint8_t Trackle_Prop_getNumberOfDecimals(Trackle_PropID_t propID)
     const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
     if (propIndex >= 0 && propIndex < numPropsCreated)
     {
-        return props[propIndex].numDecimals;
+        return propsCold->numDecimals[propIndex];
     }
     return 0;
 }
@@ -492,7 +3238,7 @@ bool Trackle_Prop_isSigned(Trackle_PropID_t propID)
     const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
     if (propIndex >= 0 && propIndex < numPropsCreated)
     {
-        return props[propIndex].sign;
+        return propsCold->sign[propIndex];
     }
     return false;
 }
@@ -0,0 +1,49 @@
+#include <trackle_utils_retry.h>
+
+#include <esp_random.h>
+
+#include "trackle_utils_internal.h"
+
+void trackleUtilsRetryReset(TrackleUtilsRetry_t *retry)
+{
+    retry->consecutiveFailures = 0;
+}
+
+bool trackleUtilsRetryIsDue(const TrackleUtilsRetry_t *retry, uint32_t nowMs)
+{
+    return retry->consecutiveFailures == 0 || (int32_t)(nowMs - retry->nextAttemptMs) >= 0;
+}
+
+uint32_t trackleUtilsRetryGetWaitMs(const TrackleUtilsRetry_t *retry, uint32_t nowMs)
+{
+    return trackleUtilsRetryIsDue(retry, nowMs) ? 0 : retry->nextAttemptMs - nowMs;
+}
+
+void trackleUtilsRetryOnFailure(TrackleUtilsRetry_t *retry, const Trackle_RetryPolicy_t *policy, uint32_t nowMs)
+{
+    // Exponential growth, stopping as soon as the max is reached so that it never overflows
+    uint64_t delayMs = policy->initialDelayMs;
+    for (uint32_t i = 0; i < retry->consecutiveFailures && delayMs < policy->maxDelayMs; i++)
+    {
+        delayMs *= policy->multiplier;
+    }
+    if (delayMs > policy->maxDelayMs)
+    {
+        delayMs = policy->maxDelayMs;
+    }
+
+    // Jitter in [-delay * jitter%, +delay * jitter%]
+    const uint32_t jitterMs = (uint32_t)(delayMs * (policy->jitterPercent > 100 ? 100 : policy->jitterPercent) / 100);
+    if (jitterMs > 0)
+    {
+        delayMs = delayMs - jitterMs + esp_random() % (2 * jitterMs + 1);
+    }
+
+    retry->consecutiveFailures++;
+    retry->nextAttemptMs = nowMs + (uint32_t)delayMs;
+}
+
+bool trackleUtilsRetryIsBudgetExhausted(const Trackle_RetryPolicy_t *policy, uint32_t retries)
+{
+    return policy->maxRetries != 0 && retries >= policy->maxRetries;
+}
@@ -0,0 +1,92 @@
+#include <trackle_utils_task.h>
+
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "trackle_utils_internal.h"
+
+// The run-time counter of FreeRTOS counts microseconds only when it's clocked by esp_timer
+#if configGENERATE_RUN_TIME_STATS == 1 && !defined(CONFIG_FREERTOS_RUN_TIME_STATS_USING_CPU_CLK)
+#define TASK_CPU_TIME_ENABLED 1
+#else
+#define TASK_CPU_TIME_ENABLED 0
+#endif
+
+// CPU time used by the calling task since it started [us], 0 without run-time statistics.
+static uint32_t getCpuTimeUs()
+{
+#if TASK_CPU_TIME_ENABLED
+    taskYIELD(); // The counter of the running task is only brought up to date when it's switched out
+    return (uint32_t)ulTaskGetRunTimeCounter(NULL);
+#else
+    return 0;
+#endif
+}
+
+bool trackleUtilsTaskIsConfigValid(const Trackle_TaskConfig_t *config)
+{
+    return config != NULL && config->periodMs / portTICK_PERIOD_MS > 0 && config->priority < configMAX_PRIORITIES &&
+           (config->coreId == tskNO_AFFINITY || (config->coreId >= 0 && config->coreId < portNUM_PROCESSORS));
+}
+
+bool trackleUtilsTaskStart(TrackleUtilsTask_t *task, TaskFunction_t code, const char *name, const Trackle_TaskConfig_t *config)
+{
+    if (!trackleUtilsTaskIsConfigValid(config))
+    {
+        return false;
+    }
+    task->config = *config;
+    memset(&task->stats, 0, sizeof(task->stats));
+    return xTaskCreatePinnedToCore(code, name, config->stackSize, NULL, config->priority, &task->handle, config->coreId) == pdTRUE;
+}
+
+TrackleUtilsLoopStart_t trackleUtilsTaskLoopBegin()
+{
+    const TrackleUtilsLoopStart_t loopStart = {.cpuUs = getCpuTimeUs(), .wallUs = esp_timer_get_time()};
+    return loopStart;
+}
+
+void trackleUtilsTaskLoopEnd(TrackleUtilsTask_t *task, TrackleUtilsLoopStart_t loopStart)
+{
+    const uint32_t loopWallTimeUs = (uint32_t)(esp_timer_get_time() - loopStart.wallUs);
+    const uint32_t loopCpuTimeUs = getCpuTimeUs() - loopStart.cpuUs; // Unsigned difference, right across the wrap around of the counter
+    portENTER_CRITICAL(&task->statsLock);
+    task->stats.loops++;
+    task->stats.lastLoopCpuTimeUs = loopCpuTimeUs;
+    task->stats.totalLoopCpuTimeUs += loopCpuTimeUs;
+    if (loopCpuTimeUs > task->stats.maxLoopCpuTimeUs)
+    {
+        task->stats.maxLoopCpuTimeUs = loopCpuTimeUs;
+    }
+    task->stats.lastLoopWallTimeUs = loopWallTimeUs;
+    task->stats.totalLoopWallTimeUs += loopWallTimeUs;
+    if (loopWallTimeUs > task->stats.maxLoopWallTimeUs)
+    {
+        task->stats.maxLoopWallTimeUs = loopWallTimeUs;
+    }
+    portEXIT_CRITICAL(&task->statsLock);
+}
+
+bool trackleUtilsTaskWaitUntil(TickType_t deadline)
+{
+    const TickType_t now = xTaskGetTickCount();
+    if (trackleUtilsIsTickReached(now, deadline))
+    {
+        return false;
+    }
+    return ulTaskNotifyTake(pdTRUE, deadline - now) > 0;
+}
+
+bool trackleUtilsTaskGetStats(TrackleUtilsTask_t *task, Trackle_TaskStats_t *stats)
+{
+    if (task->handle == NULL || stats == NULL)
+    {
+        return false;
+    }
+    portENTER_CRITICAL(&task->statsLock);
+    *stats = task->stats;
+    portEXIT_CRITICAL(&task->statsLock);
+    stats->stackHighWaterMark = uxTaskGetStackHighWaterMark(task->handle); // In bytes, since on ESP-IDF a stack element is a byte
+    return true;
+}
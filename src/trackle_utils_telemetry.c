@@ -0,0 +1,90 @@
+#include <trackle_utils_telemetry.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+
+#include "trackle_utils_internal.h"
+
+#define TRACKLE_TELEMETRY_TASK_NAME "trackle_utils_telemetry"
+
+static const char *TAG = "trackle_utils_telemetry";
+
+static TrackleUtilsTask_t telemetryTask = TRACKLE_UTILS_TASK_INIT; // Task started by Trackle_Telemetry_startTaskWithConfig
+static uint32_t notificationsPeriodMs = 0;                          // Period of the notifications engine, the task period is used by the properties engine
+
+static void trackleTelemetryTaskCode(void *arg)
+{
+    const TickType_t propertiesPeriod = telemetryTask.config.periodMs / portTICK_PERIOD_MS;
+    const TickType_t notificationsPeriod = notificationsPeriodMs / portTICK_PERIOD_MS;
+
+    const TickType_t startTime = xTaskGetTickCount();
+    TickType_t propertiesDeadline = startTime + propertiesPeriod;
+    TickType_t notificationsDeadline = startTime + notificationsPeriod;
+    trackleUtilsPropertiesBegin(trackleUtilsNowUs());
+
+    for (;;)
+    {
+        // Sleep until the earliest deadline of the two engines, or until an urgent property wakes the task up
+        const TickType_t nextWakeTime = trackleUtilsIsTickReached(propertiesDeadline, notificationsDeadline) ? notificationsDeadline : propertiesDeadline;
+        const bool notified = trackleUtilsTaskWaitUntil(nextWakeTime);
+        const TickType_t now = xTaskGetTickCount();
+        const TrackleUtilsLoopStart_t loopStart = trackleUtilsTaskLoopBegin();
+
+        // Notifications go first, so that they aren't delayed by the publication of the properties
+        if (trackleUtilsIsTickReached(now, notificationsDeadline))
+        {
+            trackleUtilsNotificationsRun();
+            notificationsDeadline += notificationsPeriod;
+        }
+        if (notified || trackleUtilsIsTickReached(now, propertiesDeadline))
+        {
+            trackleUtilsPropertiesRun(trackleUtilsNowUs());
+            if (trackleUtilsIsTickReached(now, propertiesDeadline))
+            {
+                propertiesDeadline += propertiesPeriod;
+            }
+        }
+
+        trackleUtilsTaskLoopEnd(&telemetryTask, loopStart);
+    }
+}
+
+bool Trackle_Telemetry_startTask()
+{
+    const Trackle_TaskConfig_t config = TRACKLE_TELEMETRY_TASK_CONFIG_DEFAULT();
+    return Trackle_Telemetry_startTaskWithConfig(&config, TRACKLE_TELEMETRY_NOTIFICATIONS_PERIOD_MS_DEFAULT);
+}
+
+bool Trackle_Telemetry_startTaskWithConfig(const Trackle_TaskConfig_t *config, uint32_t notificationsPeriod)
+{
+
+    ESP_LOGI(TAG, "Initializing...");
+
+    if (!trackleUtilsTaskIsConfigValid(config) || notificationsPeriod / portTICK_PERIOD_MS == 0 || !trackleUtilsPropertiesPrepare())
+    {
+        return false;
+    }
+    if (!trackleUtilsNotificationsPrepare())
+    {
+        trackleUtilsPropertiesUnprepare();
+        return false;
+    }
+    notificationsPeriodMs = notificationsPeriod;
+
+    // Task creation
+    if (trackleUtilsTaskStart(&telemetryTask, trackleTelemetryTaskCode, TRACKLE_TELEMETRY_TASK_NAME, config))
+    {
+        ESP_LOGI(TAG, "Task created successfully.");
+        return true;
+    }
+    ESP_LOGE(TAG, "Error in task creation.");
+    trackleUtilsNotificationsUnprepare();
+    trackleUtilsPropertiesUnprepare();
+    return false;
+}
+
+bool Trackle_Telemetry_getTaskStats(Trackle_TaskStats_t *stats)
+{
+    return trackleUtilsTaskGetStats(&telemetryTask, stats);
+}
@@ -0,0 +1,17 @@
+#include <trackle_utils_time.h>
+
+#include <esp_timer.h>
+
+#include "trackle_utils_internal.h"
+
+static Trackle_TimeSource_t timeSource = esp_timer_get_time; // Source of the time of the engines
+
+void Trackle_Time_setSource(Trackle_TimeSource_t source)
+{
+    timeSource = source != NULL ? source : esp_timer_get_time;
+}
+
+int64_t Trackle_Time_getUs()
+{
+    return timeSource();
+}
@@ -0,0 +1,90 @@
+#ifndef TRACKLE_UTILS_MEMORY_H
+#define TRACKLE_UTILS_MEMORY_H
+
+#include <stdbool.h>
+#include <esp_types.h>
+
+/**
+ *
+ * @file trackle_utils_memory.h
+ * @brief Datatypes and functions for choosing where the memory used by properties and notifications is allocated.
+ *
+ * The memory allocated by this component is divided in classes (see \ref Trackle_MemClass_t), and every class can be placed
+ * in internal RAM or in external RAM (PSRAM), when available. The state that the tasks touch at every tick always stays in internal RAM.
+ *
+ * The placement of a class only affects the allocations made after it is set, so \ref Trackle_Memory_setPlacement must be called before
+ * creating properties, properties groups and notifications, and before starting the tasks.
+ *
+ * Values of properties are carved from a pool of chunks allocated in the memory of \ref TRACKLE_MEM_CLASS_VALUES, and are never
+ * freed, so that many small buffers don't fragment the heap. Sizing the chunks to the total size of the values (see
+ * \ref Trackle_Memory_getValuesPoolStats) puts all of them in a single allocation.
+ *
+ */
+
+/**
+ * @brief Classes of the memory allocated by the component.
+ */
+typedef enum
+{
+    TRACKLE_MEM_CLASS_DESCRIPTORS = 0, ///< Keys, formatting parameters and other rarely accessed data of properties, groups and notifications.
+    TRACKLE_MEM_CLASS_VALUES,          ///< Values of string and enum properties, allocated from the values pool.
+    TRACKLE_MEM_CLASS_BUFFERS,         ///< Buffers where payloads are serialized before being published.
+    TRACKLE_MEM_CLASS_NUM              ///< Number of memory classes (not a valid class).
+} Trackle_MemClass_t;
+
+/**
+ * @brief Possible placements of a memory class.
+ */
+typedef enum
+{
+    TRACKLE_MEM_PLACEMENT_DEFAULT = 0,     ///< Same memory as malloc.
+    TRACKLE_MEM_PLACEMENT_INTERNAL,        ///< Internal RAM only.
+    TRACKLE_MEM_PLACEMENT_EXTERNAL,        ///< External RAM (PSRAM) only: allocations fail if it's missing or full.
+    TRACKLE_MEM_PLACEMENT_PREFER_EXTERNAL, ///< External RAM if possible, internal RAM otherwise.
+} Trackle_MemPlacement_t;
+
+/**
+ * @brief Default size of the chunks of the values pool.
+ */
+#define TRACKLE_VALUES_POOL_CHUNK_SIZE_DEFAULT 1024
+
+/**
+ * @brief Usage statistics of the values pool.
+ */
+typedef struct
+{
+    uint32_t chunks;   ///< Chunks allocated from the heap.
+    size_t capacity;   ///< Total size of the chunks [bytes].
+    size_t used;       ///< Bytes given to values, alignment padding included.
+    uint32_t failures; ///< Allocations failed because the heap was full.
+} Trackle_ValuesPoolStats_t;
+
+/**
+ * @brief Set the placement of a memory class.
+ * @param memClass Memory class.
+ * @param placement Where the memory of the class must be allocated from now on.
+ * @return true if placement was set successfully, false otherwise.
+ */
+bool Trackle_Memory_setPlacement(Trackle_MemClass_t memClass, Trackle_MemPlacement_t placement);
+
+/**
+ * @brief Get the placement of a memory class.
+ * @param memClass Memory class.
+ * @return Placement of the memory class (\ref TRACKLE_MEM_PLACEMENT_DEFAULT if \ref memClass isn't valid).
+ */
+Trackle_MemPlacement_t Trackle_Memory_getPlacement(Trackle_MemClass_t memClass);
+
+/**
+ * @brief Set the size of the chunks of the values pool allocated from now on. Values larger than a chunk get a chunk of their size.
+ * @param chunkSize Size of the chunks [bytes].
+ * @return true if the size was set, false if it's 0.
+ */
+bool Trackle_Memory_setValuesPoolChunkSize(size_t chunkSize);
+
+/**
+ * @brief Get the usage statistics of the values pool.
+ * @param stats Where the statistics are copied.
+ */
+void Trackle_Memory_getValuesPoolStats(Trackle_ValuesPoolStats_t *stats);
+
+#endif
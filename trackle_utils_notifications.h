@@ -5,6 +5,9 @@
 #include <esp_types.h>
 #include <esp_timer.h>
 
+#include <trackle_utils_retry.h>
+#include <trackle_utils_task.h>
+
 /**
  *
  * @file trackle_utils_notifications.h
@@ -38,6 +41,17 @@
  */
 #define TRACKLE_MAX_NOTIFICATIONS_NUM 20
 
+/**
+ * @brief Default configuration of the notifications task, used by \ref Trackle_Notifications_startTask.
+ */
+#define TRACKLE_NOTIFICATIONS_TASK_CONFIG_DEFAULT() \
+    {                                               \
+        .stackSize = 8192,                          \
+        .priority = tskIDLE_PRIORITY + 10,          \
+        .coreId = 1,                                \
+        .periodMs = 1000,                           \
+    }
+
 /**
  * @brief Value returned on error by functions returning \ref Trackle_NotificationID_t
  */
@@ -75,6 +89,34 @@ bool Trackle_Notification_update(Trackle_NotificationID_t notificationID, uint8_
  */
 bool Trackle_Notifications_startTask();
 
+/**
+ * @brief Start the task that publishes periodically the notifications created, with a custom configuration.
+ * @param config Configuration of the task (see \ref TRACKLE_NOTIFICATIONS_TASK_CONFIG_DEFAULT for the default one).
+ * @return true if task started successfully, false otherwise.
+ */
+bool Trackle_Notifications_startTaskWithConfig(const Trackle_TaskConfig_t *config);
+
+/**
+ * @brief Get the statistics of the notifications task, to tune its configuration.
+ * @param stats Structure where to store the statistics.
+ * @return true on success, false if the task wasn't started by \ref Trackle_Notifications_startTask or \ref Trackle_Notifications_startTaskWithConfig.
+ */
+bool Trackle_Notifications_getTaskStats(Trackle_TaskStats_t *stats);
+
+/**
+ * @brief Set the policy for retrying the notifications that failed to be published. A notification whose retry budget is exhausted
+ * is dropped, and published again only when its level changes. Default policy is \ref TRACKLE_RETRY_POLICY_DEFAULT.
+ * @param policy Retry policy (multiplier must be at least 1).
+ * @return true if policy was set successfully, false otherwise.
+ */
+bool Trackle_Notifications_setRetryPolicy(const Trackle_RetryPolicy_t *policy);
+
+/**
+ * @brief Get the counters of the notifications published so far.
+ * @param stats Structure where to store the counters.
+ */
+void Trackle_Notifications_getPublishStats(Trackle_PublishStats_t *stats);
+
 /**
  * @brief Get key of an notification.
  * @param notificationID ID of the notification.
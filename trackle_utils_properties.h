@@ -5,6 +5,9 @@
 #include <esp_types.h>
 #include <esp_timer.h>
 
+#include <trackle_utils_retry.h>
+#include <trackle_utils_task.h>
+
 /**
  *
  * @file trackle_utils_properties.h
@@ -27,7 +30,7 @@
  *
  * Then, in order to create properties, one must follow these steps:
  *  1. Declare a variable of type \ref Trackle_PropID_t;
- *  2. Assign the result of \ref Trackle_Prop_create or \ref Trackle_Prop_createString to this variable;
+ *  2. Assign the result of \ref Trackle_Prop_create, \ref Trackle_Prop_createString, or of the function creating another kind of property to this variable;
  *  3. Add the created property to one or more groups with \ref Trackle_PropGroup_addProp;
  *  4. Repeat the steps from 1 to 3 for all the properties that must be created;
  *  5. Call \ref Trackle_Props_startTask to start the properties task.
@@ -51,6 +54,43 @@
  */
 #define TRACKLE_MAX_PROPS_NUM 40
 
+/**
+ * @brief Max number of 64-bit properties (int64 and uint64) that can be created, included in \ref TRACKLE_MAX_PROPS_NUM.
+ */
+#define TRACKLE_MAX_WIDE_PROPS_NUM 8
+
+/**
+ * @brief Max number of series properties that can be created, included in \ref TRACKLE_MAX_PROPS_NUM.
+ */
+#define TRACKLE_MAX_SERIES_PROPS_NUM 4
+
+/**
+ * @brief Max number of flags of a bitfield property.
+ */
+#define TRACKLE_MAX_BITFIELD_FLAGS 32
+
+/**
+ * @brief Default configuration of the properties task, used by \ref Trackle_Props_startTask.
+ */
+#define TRACKLE_PROPERTIES_TASK_CONFIG_DEFAULT() \
+    {                                            \
+        .stackSize = 8192,                       \
+        .priority = tskIDLE_PRIORITY + 10,       \
+        .coreId = 1,                             \
+        .periodMs = 100,                         \
+    }
+
+/**
+ * @brief Default configuration of the properties sender task, to be used with \ref Trackle_Props_startSenderTask.
+ */
+#define TRACKLE_PROPERTIES_SENDER_TASK_CONFIG_DEFAULT() \
+    {                                                   \
+        .stackSize = 8192,                              \
+        .priority = tskIDLE_PRIORITY + 10,              \
+        .coreId = 1,                                    \
+        .periodMs = 100,                                \
+    }
+
 /**
  * @brief Value returned on error by functions returning \ref Trackle_PropGroupID_t
  */
@@ -71,6 +111,177 @@ typedef int Trackle_PropGroupID_t;
  */
 typedef int Trackle_PropID_t;
 
+/**
+ * @brief Max number of updates staged by a transaction.
+ */
+#define TRACKLE_PROP_TXN_MAX_UPDATES 8
+
+/**
+ * @brief Event where the key dictionary is published (see \ref Trackle_Props_enableKeyDictionary).
+ */
+#define TRACKLE_PROPS_KEY_DICTIONARY_EVENT "trackle/props/keys"
+
+/**
+ * @brief Transaction staging updates of numeric properties, that become visible to the publisher all together on commit,
+ * and are always published in the same payload. It's owned by the caller and must be used by a single task.
+ */
+typedef struct
+{
+    Trackle_PropID_t propIds[TRACKLE_PROP_TXN_MAX_UPDATES]; ///< Properties updated by the transaction.
+    int32_t values[TRACKLE_PROP_TXN_MAX_UPDATES];           ///< New values of the properties.
+    int numUpdates;                                         ///< Number of the updates staged.
+} Trackle_PropTxn_t;
+
+/**
+ * @brief How a bitfield property is published.
+ */
+typedef enum
+{
+    TRACKLE_BITFIELD_FORMAT_MASK = 0, ///< As an integer, with the flag of index i in bit i (e.g. "io":5).
+    TRACKLE_BITFIELD_FORMAT_NAMED,    ///< As an object of named booleans (e.g. "io":{"door":true,"pump":false,"fan":true}).
+} Trackle_BitfieldFormat_t;
+
+/**
+ * @brief How the samples of a series property are published. In both formats they are preceded by the time of the first
+ * sample, as "t" (wall-clock ms since epoch) or as "u" (ms since boot, until the wall clock is set), and by the interval
+ * between samples [ms] as "i".
+ */
+typedef enum
+{
+    TRACKLE_SERIES_FORMAT_DELTA_BASE64 = 0, ///< First sample and differences between consecutive samples, as zigzag varints, in base64
+                                            ///< (e.g. "vib":{"t":1700000000000,"i":10,"d":"AgIDAQ=="}). Raw bytes in CBOR payloads.
+    TRACKLE_SERIES_FORMAT_ARRAY,            ///< Array of the samples (e.g. "vib":{"t":1700000000000,"i":10,"v":[1,2,0,-1]}).
+} Trackle_SeriesFormat_t;
+
+/**
+ * @brief Configuration of a series property (see \ref Trackle_Prop_createSeries).
+ */
+typedef struct
+{
+    uint16_t capacity;             ///< Max number of samples buffered (after decimation) until they are published.
+    uint32_t intervalMs;           ///< Interval between the samples added by \ref Trackle_Prop_addSample [ms].
+    uint8_t decimation;            ///< Number of consecutive samples averaged into each buffered sample (1 to keep all of them).
+    Trackle_SeriesFormat_t format; ///< How the samples are published.
+} Trackle_SeriesConfig_t;
+
+/**
+ * @brief Default configuration of a series property: 64 samples, one every 100 ms, as base64 deltas.
+ */
+#define TRACKLE_SERIES_CONFIG_DEFAULT()               \
+    {                                                 \
+        .capacity = 64,                               \
+        .intervalMs = 100,                            \
+        .decimation = 1,                              \
+        .format = TRACKLE_SERIES_FORMAT_DELTA_BASE64, \
+    }
+
+/**
+ * @brief Priority of a property.
+ */
+typedef enum
+{
+    TRACKLE_PROP_PRIORITY_LOW = 0, ///< Published after all the others during resync.
+    TRACKLE_PROP_PRIORITY_NORMAL,  ///< Default priority.
+    TRACKLE_PROP_PRIORITY_HIGH,    ///< Published before all the others during resync.
+    TRACKLE_PROP_PRIORITY_URGENT,  ///< Published as soon as it changes, without waiting for its groups, together with the groups that are due.
+} Trackle_PropPriority_t;
+
+/**
+ * @brief What a group does when its task was late by one or more whole periods, and some deadlines were missed.
+ * In both cases the following deadlines stay on the grid of the period.
+ */
+typedef enum
+{
+    TRACKLE_PROPGROUP_MISSED_FIRE_ONCE = 0, ///< Publish once for all the missed deadlines (default).
+    TRACKLE_PROPGROUP_MISSED_SKIP,          ///< Don't publish, wait for the next deadline.
+} Trackle_PropGroupMissedPolicy_t;
+
+/**
+ * @brief Encoding of the payloads of the properties. The properties published in the same round with different
+ * encodings are sent in different payloads.
+ */
+typedef enum
+{
+    TRACKLE_PROPS_ENCODING_JSON = 0,    ///< JSON object (default).
+    TRACKLE_PROPS_ENCODING_CBOR_BASE64, ///< CBOR map (RFC 8949) encoded in base64, since payloads are sent as text. Integers
+                                        ///< are kept binary, scaled numbers are decimal fractions (tag 4) when the scale is a power of 10.
+} Trackle_PropsEncoding_t;
+
+/**
+ * @brief Timing added to the payloads of the properties, so that the cloud doesn't have to rely on their arrival time.
+ * Times are wall-clock ms since epoch in "_ts", or ms since boot in "_up" until the wall clock is set.
+ */
+typedef enum
+{
+    TRACKLE_PROPS_TIMESTAMPS_NONE = 0, ///< No timing (default).
+    TRACKLE_PROPS_TIMESTAMPS_PAYLOAD,  ///< Time each payload was built, and its sequence number in "_seq", increasing by 1
+                                       ///< at each payload (a gap means a payload was lost): {"_ts":1700000000000,"_seq":41,"temp":21.5}.
+    TRACKLE_PROPS_TIMESTAMPS_PROPERTY, ///< As \ref TRACKLE_PROPS_TIMESTAMPS_PAYLOAD, plus the age of the value of each property
+                                       ///< [ms before the payload time], in "_dt", in the order of the properties in the payload:
+                                       ///< {"_ts":1700000000000,"_seq":41,"temp":21.5,"hum":40,"_dt":[120,3]}.
+} Trackle_PropsTimestamps_t;
+
+/**
+ * @brief Bandwidth budget of the properties, enforced by two token buckets. When the budget is exhausted, nothing is
+ * published and the changed properties stay changed: they are published later with their latest value.
+ * A payload is sent if the bytes budget is not negative, and its size is then subtracted, so the budget may go
+ * below zero by at most a payload and no property is ever too large to be published.
+ */
+typedef struct
+{
+    uint32_t bytesPerSecond;    ///< Average bytes published per second (0 for no limit).
+    uint32_t burstBytes;        ///< Max bytes published at once after an idle time (0 to use \ref bytesPerSecond).
+    uint16_t payloadsPerMinute; ///< Average payloads published per minute (0 for no limit).
+    uint16_t burstPayloads;     ///< Max payloads published at once after an idle time (0 to use \ref payloadsPerMinute).
+} Trackle_PropsBudget_t;
+
+/**
+ * @brief Default budget: no limit.
+ */
+#define TRACKLE_PROPS_BUDGET_DEFAULT() \
+    {                                  \
+        .bytesPerSecond = 0,           \
+        .burstBytes = 0,               \
+        .payloadsPerMinute = 0,        \
+        .burstPayloads = 0,            \
+    }
+
+/**
+ * @brief Predicted traffic of a properties group.
+ */
+typedef struct
+{
+    uint32_t phaseMs;        ///< Offset of the publications of the group from the grid of its period [ms].
+    uint32_t predictedBytes; ///< Max number of bytes the properties of the group take in a payload.
+    uint32_t bytesPerSecond; ///< Max average traffic of the group [bytes/s].
+} Trackle_PropGroupProfile_t;
+
+/**
+ * @brief Configuration of the resync, that is the publication of all the properties in groups after the device connects.
+ *
+ * The resync starts at a random time within \ref windowMs after connection, so that a fleet of devices connecting together
+ * doesn't publish all at the same time, and publishes the properties in chunks, in order of priority. Properties already
+ * published by their groups since the connection are not published again by the resync.
+ */
+typedef struct
+{
+    uint32_t windowMs;        ///< The resync starts at a random time between 0 and this time after connection [ms] (0 to start at once).
+    uint16_t chunkProps;      ///< Max number of properties published in every chunk (0 to publish all of them in a single chunk).
+    uint32_t chunkIntervalMs; ///< Time between two chunks [ms].
+    bool onReconnect;         ///< If true, resync after every reconnection, otherwise only after the first connection.
+} Trackle_PropsResyncConfig_t;
+
+/**
+ * @brief Default resync configuration: all the properties are published at once, only after the first connection.
+ */
+#define TRACKLE_PROPS_RESYNC_CONFIG_DEFAULT() \
+    {                                         \
+        .windowMs = 0,                        \
+        .chunkProps = 0,                      \
+        .chunkIntervalMs = 0,                 \
+        .onReconnect = false,                 \
+    }
+
 /**
  * @brief Create a new properties group, grouping properties that must be published with the same period.
  * @param periodMs Period for the publication of the properties belonging to the group [ms]
@@ -87,6 +298,68 @@ Trackle_PropGroupID_t Trackle_PropGroup_create(uint32_t periodMs, bool onlyIfCha
  */
 bool Trackle_PropGroup_addProp(Trackle_PropID_t propId, Trackle_PropGroupID_t propGroupId);
 
+/**
+ * @brief Choose what a group does when whole periods were missed (by default it publishes once).
+ * @param propGroupId ID of the group.
+ * @param policy Policy for the missed deadlines.
+ * @return true if the policy was set, false if the group doesn't exist.
+ */
+bool Trackle_PropGroup_setMissedPolicy(Trackle_PropGroupID_t propGroupId, Trackle_PropGroupMissedPolicy_t policy);
+
+/**
+ * @brief Align the deadlines of a group to multiples of its period in wall-clock time (e.g. the top of each minute for a
+ * 60 s group), so that data of different devices refer to the same instants. Until the wall clock is set (e.g. by SNTP),
+ * the group is published as if it wasn't aligned. It must be called before starting the task.
+ * @param propGroupId ID of the group.
+ * @param align true to align the group to the wall clock, false to publish it a period after the task start.
+ * @return true if the alignment was set, false if the group doesn't exist.
+ */
+bool Trackle_PropGroup_setWallClockAlignment(Trackle_PropGroupID_t propGroupId, bool align);
+
+/**
+ * @brief Publish the properties of a group also as soon as their debounce delay expires, instead of waiting for the next
+ * period of the group: a timer wakes up the task when a property settles, and only the changed properties are published.
+ * The group is still published at every period.
+ * @param propGroupId ID of the group.
+ * @param enable true to publish settled properties right away, false to publish them only at the period of the group.
+ * @param minIntervalMs Min time between the latest publication of the group and one triggered by a settled property [ms].
+ * @return true if the setting was applied, false if the group doesn't exist or the timer can't be created.
+ */
+bool Trackle_PropGroup_setPublishOnSettle(Trackle_PropGroupID_t propGroupId, bool enable, uint32_t minIntervalMs);
+
+/**
+ * @brief Set the encoding of the payloads with the properties of a group. It must be called before starting the task.
+ * @param propGroupId ID of the group.
+ * @param encoding Encoding of the payloads (default is \ref TRACKLE_PROPS_ENCODING_JSON).
+ * @return true if the encoding was set, false if the group doesn't exist, the encoding is invalid or its buffer can't be allocated.
+ */
+bool Trackle_PropGroup_setEncoding(Trackle_PropGroupID_t propGroupId, Trackle_PropsEncoding_t encoding);
+
+/**
+ * @brief Assign to the groups phase offsets that spread their publications over time, so that groups with harmonic
+ * periods don't publish together in a single large payload. Phases are chosen to minimize the predicted peak payload
+ * size, and then the peak-to-average ratio of the traffic. Groups aligned to the wall clock, and groups published at
+ * every round, keep phase 0. It must be called after all the groups are filled, and before starting the task.
+ * @param resolutionMs Time resolution of the phases: the period of the task running the properties engine [ms].
+ * @return true if phases were assigned, false otherwise.
+ */
+bool Trackle_PropGroups_spreadPhases(uint32_t resolutionMs);
+
+/**
+ * @brief Get the predicted traffic of a group.
+ * @param propGroupId ID of the group.
+ * @param profile Where the profile is copied.
+ * @return true if the profile was copied, false if the group doesn't exist.
+ */
+bool Trackle_PropGroup_getProfile(Trackle_PropGroupID_t propGroupId, Trackle_PropGroupProfile_t *profile);
+
+/**
+ * @brief Get the predicted size of the largest payload published by the groups, with their current phases.
+ * @param resolutionMs Time resolution of the prediction: the period of the task running the properties engine [ms].
+ * @return Predicted peak payload size [bytes], or 0 on failure.
+ */
+uint32_t Trackle_PropGroups_getPredictedPeakBytes(uint32_t resolutionMs);
+
 /**
  * @brief Create a new numeric property.
  * @param name Name/key to be assigned to the property.
@@ -105,6 +378,62 @@ Trackle_PropID_t Trackle_Prop_create(const char *name, uint16_t scale, uint8_t n
  */
 Trackle_PropID_t Trackle_Prop_createString(const char *name, int maxLength);
 
+/**
+ * @brief Create a new float property, published with the given number of decimals.
+ * @param name Name/key to be assigned to the property.
+ * @param numDecimals Number of decimal digits to be used when publishing the property to the cloud.
+ * @return ID associated with the new created property, or \ref Trackle_PropID_ERROR on failure.
+ */
+Trackle_PropID_t Trackle_Prop_createFloat(const char *name, uint8_t numDecimals);
+
+/**
+ * @brief Create a new signed 64-bit integer property (e.g. an energy counter).
+ * At most \ref TRACKLE_MAX_WIDE_PROPS_NUM 64-bit properties can be created.
+ * @param name Name/key to be assigned to the property.
+ * @return ID associated with the new created property, or \ref Trackle_PropID_ERROR on failure.
+ */
+Trackle_PropID_t Trackle_Prop_createInt64(const char *name);
+
+/**
+ * @brief Create a new unsigned 64-bit integer property.
+ * At most \ref TRACKLE_MAX_WIDE_PROPS_NUM 64-bit properties can be created.
+ * @param name Name/key to be assigned to the property.
+ * @return ID associated with the new created property, or \ref Trackle_PropID_ERROR on failure.
+ */
+Trackle_PropID_t Trackle_Prop_createUint64(const char *name);
+
+/**
+ * @brief Create a new bitfield property, holding up to \ref TRACKLE_MAX_BITFIELD_FLAGS boolean flags (e.g. digital I/O states)
+ * in a single property. Flags are set with \ref Trackle_Prop_setBit, or all together with \ref Trackle_Prop_update (as a mask).
+ * @param name Name/key to be assigned to the property.
+ * @param flagNames Names of the flags, from bit 0. The array and the strings are not copied, they must live as long as the property.
+ * Can be NULL if format is \ref TRACKLE_BITFIELD_FORMAT_MASK.
+ * @param numFlags Number of the flags.
+ * @param format How the property is published.
+ * @return ID associated with the new created property, or \ref Trackle_PropID_ERROR on failure.
+ */
+Trackle_PropID_t Trackle_Prop_createBitfield(const char *name, const char *const *flagNames, uint8_t numFlags, Trackle_BitfieldFormat_t format);
+
+/**
+ * @brief Create a new enum property, whose value is the index of a label and is published as the label itself
+ * (e.g. "state":"charging"). It's updated with \ref Trackle_Prop_update, passing the index of the label.
+ * @param name Name/key to be assigned to the property.
+ * @param labels Labels of the values, from index 0. The array and the strings are not copied, they must live as long as the property.
+ * @param numLabels Number of the labels.
+ * @return ID associated with the new created property, or \ref Trackle_PropID_ERROR on failure.
+ */
+Trackle_PropID_t Trackle_Prop_createEnum(const char *name, const char *const *labels, uint8_t numLabels);
+
+/**
+ * @brief Create a new series property, that buffers many samples taken at a fixed interval and publishes all the ones
+ * buffered since the previous publication at once, whenever its groups are due and there are new samples (see
+ * \ref Trackle_SeriesFormat_t). Samples that don't fit in a payload are published in the following ones.
+ * @param name Name/key to be assigned to the property.
+ * @param config Configuration of the series.
+ * @return ID associated with the new created property, or \ref Trackle_PropID_ERROR on failure.
+ */
+Trackle_PropID_t Trackle_Prop_createSeries(const char *name, const Trackle_SeriesConfig_t *config);
+
 /**
  * @brief Update the value of a numeric property.
  * @param propID ID of the property to be updated.
@@ -113,6 +442,39 @@ Trackle_PropID_t Trackle_Prop_createString(const char *name, int maxLength);
  */
 bool Trackle_Prop_update(Trackle_PropID_t propID, int newValue);
 
+/**
+ * @brief Update the value of a float property.
+ * @param propID ID of the property to be updated.
+ * @param newValue New value of the property.
+ * @return true if the value changed, false otherwise.
+ */
+bool Trackle_Prop_updateFloat(Trackle_PropID_t propID, float newValue);
+
+/**
+ * @brief Update the value of a signed 64-bit integer property.
+ * @param propID ID of the property to be updated.
+ * @param newValue New value of the property.
+ * @return true if the value changed, false otherwise.
+ */
+bool Trackle_Prop_updateInt64(Trackle_PropID_t propID, int64_t newValue);
+
+/**
+ * @brief Update the value of an unsigned 64-bit integer property.
+ * @param propID ID of the property to be updated.
+ * @param newValue New value of the property.
+ * @return true if the value changed, false otherwise.
+ */
+bool Trackle_Prop_updateUint64(Trackle_PropID_t propID, uint64_t newValue);
+
+/**
+ * @brief Set a flag of a bitfield property.
+ * @param propID ID of the property to be updated.
+ * @param bit Index of the flag.
+ * @param value New value of the flag.
+ * @return true if the flag changed, false otherwise.
+ */
+bool Trackle_Prop_setBit(Trackle_PropID_t propID, uint8_t bit, bool value);
+
 /**
  * @brief Update the value of a string property.
  * @param propID ID of the property to be updated.
@@ -121,6 +483,70 @@ bool Trackle_Prop_update(Trackle_PropID_t propID, int newValue);
  */
 bool Trackle_Prop_updateString(Trackle_PropID_t propID, const char *newValue);
 
+/**
+ * @brief Update the value of a string property with a string of known length, that doesn't need to be null-terminated.
+ * Values longer than the max length of the property are truncated.
+ * @param propID ID of the property to be updated.
+ * @param newValue New value of the property.
+ * @param length Length of the new value.
+ * @return true if the value changed, false otherwise.
+ */
+bool Trackle_Prop_updateStringWithLength(Trackle_PropID_t propID, const char *newValue, size_t length);
+
+/**
+ * @brief Update the values of many numeric properties at once, reading the time once and waking up the publisher at most once.
+ * @param propIDs IDs of the properties to be updated. Invalid IDs and string properties are skipped.
+ * @param newValues New values of the properties, in the same order as \ref propIDs.
+ * @param n Number of the properties to be updated.
+ * @return Number of the properties whose value changed.
+ */
+size_t Trackle_Prop_updateMany(const Trackle_PropID_t *propIDs, const int32_t *newValues, size_t n);
+
+/**
+ * @brief Update the values of numeric properties with consecutive IDs (e.g. created one after the other for the readings
+ * of a sensor frame). IDs are validated once for the whole range.
+ * @param firstPropID ID of the first property to be updated.
+ * @param newValues New values of the properties, starting from the one of \ref firstPropID. String properties are skipped.
+ * @param n Number of the properties to be updated.
+ * @return Number of the properties whose value changed, 0 if the range is not valid.
+ */
+size_t Trackle_Prop_updateRange(Trackle_PropID_t firstPropID, const int32_t *newValues, size_t n);
+
+/**
+ * @brief Add a sample to a series property. Samples are assumed to be added every \ref Trackle_SeriesConfig_t.intervalMs:
+ * their times are computed from the time of the latest one. With decimation, a sample is buffered once every
+ * \ref Trackle_SeriesConfig_t.decimation calls, as the average of the samples added meanwhile.
+ * @param propID ID of the property.
+ * @param sample Sample to be added.
+ * @return true if the sample was added, false if \ref propID doesn't identify a series property or the buffer is full
+ * (samples not published yet are kept, new ones are dropped).
+ */
+bool Trackle_Prop_addSample(Trackle_PropID_t propID, int32_t sample);
+
+/**
+ * @brief Begin a transaction, discarding the updates staged so far.
+ * @param txn Transaction to be begun.
+ */
+void Trackle_PropTxn_begin(Trackle_PropTxn_t *txn);
+
+/**
+ * @brief Stage the update of a numeric property in a transaction. Nothing is visible until the transaction is committed.
+ * @param txn Transaction where to stage the update.
+ * @param propID ID of the property, that must be numeric.
+ * @param newValue New value of the property.
+ * @return true if the update was staged, false if the property doesn't exist, is a string, or the transaction is full.
+ */
+bool Trackle_PropTxn_update(Trackle_PropTxn_t *txn, Trackle_PropID_t propID, int32_t newValue);
+
+/**
+ * @brief Commit a transaction: its values are set all together in a short critical section, and are published in the
+ * same payload as soon as one of them must be published. Debounce delays apply as with \ref Trackle_Prop_update.
+ * A later update of one of the properties outside the transaction detaches it from the others.
+ * @param txn Transaction to be committed. It's empty afterwards.
+ * @return true if the transaction was committed, false if it was empty.
+ */
+bool Trackle_PropTxn_commit(Trackle_PropTxn_t *txn);
+
 /**
  * @brief Set the abilitation of a property.
  * @param propID ID of the property.
@@ -137,6 +563,22 @@ bool Trackle_Prop_setDisabled(Trackle_PropID_t propID, bool isDisabled);
  */
 bool Trackle_Prop_setDebounceDelay(Trackle_PropID_t propID, uint32_t debounceDelayMs);
 
+/**
+ * @brief Set the debounce delay of a property with microsecond resolution, like \ref Trackle_Prop_setDebounceDelay.
+ * @param propID ID of the property.
+ * @param debounceDelayUs Microseconds of the delay.
+ * @return If true, debounce delay set successfully, else false.
+ */
+bool Trackle_Prop_setDebounceDelayUs(Trackle_PropID_t propID, uint64_t debounceDelayUs);
+
+/**
+ * @brief Set the priority of a property.
+ * @param propID ID of the property.
+ * @param priority Priority of the property (default is \ref TRACKLE_PROP_PRIORITY_NORMAL).
+ * @return true if priority was set successfully, false otherwise.
+ */
+bool Trackle_Prop_setPriority(Trackle_PropID_t propID, Trackle_PropPriority_t priority);
+
 /**
  * @brief Get abilitation of a property.
  * @param propID ID of the property.
@@ -152,12 +594,48 @@ bool Trackle_Prop_isDisabled(Trackle_PropID_t propID);
 const char *Trackle_Prop_getKey(Trackle_PropID_t propID);
 
 /**
- * @brief Get value of a property.
+ * @brief Get value of a property (the mask for bitfield properties).
  * @param propID ID of the property.
- * @return Value of the property (-1 if \ref propID doesn't identify a valid property)
+ * @return Value of the property (-1 if \ref propID doesn't identify a valid property, or a float or 64-bit one)
  */
 int32_t Trackle_Prop_getValue(Trackle_PropID_t propID);
 
+/**
+ * @brief Get value of a float property.
+ * @param propID ID of the property.
+ * @return Value of the property (NAN if \ref propID doesn't identify a float property)
+ */
+float Trackle_Prop_getFloat(Trackle_PropID_t propID);
+
+/**
+ * @brief Get value of a signed 64-bit integer property.
+ * @param propID ID of the property.
+ * @return Value of the property (-1 if \ref propID doesn't identify an int64 property)
+ */
+int64_t Trackle_Prop_getInt64(Trackle_PropID_t propID);
+
+/**
+ * @brief Get value of an unsigned 64-bit integer property.
+ * @param propID ID of the property.
+ * @return Value of the property (0 if \ref propID doesn't identify a uint64 property)
+ */
+uint64_t Trackle_Prop_getUint64(Trackle_PropID_t propID);
+
+/**
+ * @brief Get the label of the value of an enum property.
+ * @param propID ID of the property.
+ * @return Label of the value (empty string if \ref propID doesn't identify an enum property)
+ */
+const char *Trackle_Prop_getEnumLabel(Trackle_PropID_t propID);
+
+/**
+ * @brief Get a flag of a bitfield property.
+ * @param propID ID of the property.
+ * @param bit Index of the flag.
+ * @return Value of the flag (false if \ref propID doesn't identify a bitfield property, or the flag doesn't exist)
+ */
+bool Trackle_Prop_getBit(Trackle_PropID_t propID, uint8_t bit);
+
 /**
  * @brief Get value of a string property.
  * @param propID ID of the property.
@@ -194,12 +672,116 @@ bool Trackle_Prop_isSigned(Trackle_PropID_t propID);
  */
 bool Trackle_Props_startTask();
 
+/**
+ * @brief Start the task that publishes periodically the properties contained in every property group, with a custom configuration.
+ * @param config Configuration of the task (see \ref TRACKLE_PROPERTIES_TASK_CONFIG_DEFAULT for the default one).
+ * @return true if task started successfully, false otherwise.
+ */
+bool Trackle_Props_startTaskWithConfig(const Trackle_TaskConfig_t *config);
+
+/**
+ * @brief Get the statistics of the properties task, to tune its configuration.
+ * @param stats Structure where to store the statistics.
+ * @return true on success, false if the task wasn't started by \ref Trackle_Props_startTask or \ref Trackle_Props_startTaskWithConfig.
+ */
+bool Trackle_Props_getTaskStats(Trackle_TaskStats_t *stats);
+
+/**
+ * @brief Start a task that sends the payloads of the properties, so that the properties task only serializes them and never blocks on the network.
+ * Up to two payloads can wait to be sent: when both are waiting, the properties task keeps handling groups and debounce, and changed properties
+ * are published as soon as a payload is sent. If this function isn't called, payloads are sent directly by the properties task.
+ * It must be called before \ref Trackle_Props_startTask (or \ref Trackle_Telemetry_startTask).
+ * @param config Configuration of the task (see \ref TRACKLE_PROPERTIES_SENDER_TASK_CONFIG_DEFAULT for the default one). The period is the max time between two checks of the connection while waiting to send.
+ * @return true if task started successfully, false otherwise.
+ */
+bool Trackle_Props_startSenderTask(const Trackle_TaskConfig_t *config);
+
+/**
+ * @brief Get the statistics of the properties sender task, to tune its configuration.
+ * @param stats Structure where to store the statistics.
+ * @return true on success, false if the task wasn't started by \ref Trackle_Props_startSenderTask.
+ */
+bool Trackle_Props_getSenderTaskStats(Trackle_TaskStats_t *stats);
+
+/**
+ * @brief Set the policy for retrying the payloads of properties that failed to be sent. A failed payload is sent again as it is
+ * (values included in it aren't updated): if its retry budget is exhausted, it's dropped and its properties are published again
+ * with their latest values. Default policy is \ref TRACKLE_RETRY_POLICY_DEFAULT.
+ * @param policy Retry policy (multiplier must be at least 1).
+ * @return true if policy was set successfully, false otherwise.
+ */
+bool Trackle_Props_setRetryPolicy(const Trackle_RetryPolicy_t *policy);
+
+/**
+ * @brief Get the counters of the payloads of properties sent so far.
+ * @param stats Structure where to store the counters.
+ */
+void Trackle_Props_getPublishStats(Trackle_PublishStats_t *stats);
+
 /**
  * @brief Get the number of the properties created so far.
  * @return Number of properties created.
  */
 int Trackle_Props_getNumber();
 
+/**
+ * @brief Set the bandwidth budget of the properties (see \ref Trackle_PropsBudget_t). It must be called before starting the task.
+ * @param budget Budget to be used.
+ * @return true if the budget was set, false if it's NULL.
+ */
+bool Trackle_Props_setBudget(const Trackle_PropsBudget_t *budget);
+
+/**
+ * @brief Set the encoding of the payloads of the properties published outside of their groups: urgent properties and
+ * the chunks of the resync after connection. It must be called before starting the task.
+ * @param encoding Encoding of the payloads (default is \ref TRACKLE_PROPS_ENCODING_JSON).
+ * @return true if the encoding was set, false if it's invalid or its buffer can't be allocated.
+ */
+bool Trackle_Props_setEncoding(Trackle_PropsEncoding_t encoding);
+
+/**
+ * @brief Set the timing added to the payloads (see \ref Trackle_PropsTimestamps_t). It must be called before starting the task.
+ * @param mode Timing to be added (default is \ref TRACKLE_PROPS_TIMESTAMPS_NONE).
+ * @return true if the mode was set, false if it's invalid.
+ */
+bool Trackle_Props_setTimestamps(Trackle_PropsTimestamps_t mode);
+
+/**
+ * @brief Refer to properties by numeric ids instead of keys in the payloads. In every session (and again when properties
+ * are added) the device publishes in the event \ref TRACKLE_PROPS_KEY_DICTIONARY_EVENT the list of the keys of all the
+ * properties, where the id of a key is its position, together with a version hash of the list:
+ * {"v":"1a2b3c4d","o":0,"n":3,"k":["temp","hum","door"]} (long lists are split in several events, "o" being the id of
+ * the first key of each). Then payloads carry the version in "_k" and use the ids as keys: {"_k":"1a2b3c4d","0":21.5}
+ * (integer keys in CBOR). Full keys are used until the whole dictionary is published, and while resyncing after connection.
+ * It must be called before starting the task.
+ * @param enable true to use the dictionary, false to always use full keys (default).
+ */
+void Trackle_Props_enableKeyDictionary(bool enable);
+
+/**
+ * @brief Set how the properties are published again after connection (see \ref Trackle_PropsResyncConfig_t).
+ * @param config Resync configuration (default is \ref TRACKLE_PROPS_RESYNC_CONFIG_DEFAULT).
+ * @return true if configuration was set successfully, false otherwise.
+ */
+bool Trackle_Props_setResyncConfig(const Trackle_PropsResyncConfig_t *config);
+
+/**
+ * @brief Store the last published values of the properties in NVS, so that after a reboot the resync and the groups
+ * only publish the properties whose value differs from the one the cloud already has.
+ * Values are written lazily, all together, at most once every \ref minWriteIntervalMs, and only if some of them changed.
+ * It must be called after all the properties are created, and before starting the task. NVS must be already initialized.
+ * @param nvsNamespace NVS namespace where values are stored, reserved to this purpose.
+ * @param minWriteIntervalMs Min time between two writes to NVS [ms]: the higher, the lower the flash wear.
+ * @return true if persistence was enabled and stored values were restored, false otherwise.
+ */
+bool Trackle_Props_enablePersistence(const char *nvsNamespace, uint32_t minWriteIntervalMs);
+
+/**
+ * @brief Get the number of the properties in groups that weren't published yet since the latest resync started.
+ * @return Number of properties still to be published by the resync.
+ */
+int Trackle_Props_getUnsyncedNumber();
+
 /**
  * @brief Set dafault value and changed of a new property
  * @param value Default value of a property
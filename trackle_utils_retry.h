@@ -0,0 +1,54 @@
+#ifndef TRACKLE_UTILS_RETRY_H
+#define TRACKLE_UTILS_RETRY_H
+
+#include <esp_types.h>
+
+/**
+ *
+ * @file trackle_utils_retry.h
+ * @brief Datatypes for configuring how failed publications are retried, and for monitoring publications.
+ *
+ * When a publication fails, it's retried after a delay that starts from \ref Trackle_RetryPolicy_t.initialDelayMs and is
+ * multiplied by \ref Trackle_RetryPolicy_t.multiplier at every consecutive failure, up to \ref Trackle_RetryPolicy_t.maxDelayMs.
+ * Every delay is randomly varied by \ref Trackle_RetryPolicy_t.jitterPercent, so that devices failing together don't retry together.
+ * The delay is reset by the first successful publication.
+ *
+ */
+
+/**
+ * @brief Policy for retrying failed publications.
+ */
+typedef struct
+{
+    uint32_t initialDelayMs; ///< Delay after the first failure [ms].
+    uint32_t maxDelayMs;     ///< Max delay between two attempts [ms].
+    uint16_t multiplier;     ///< Factor multiplying the delay at every consecutive failure (1 for a constant delay).
+    uint8_t jitterPercent;   ///< Max random variation of every delay, in percentage of the delay (0-100).
+    uint32_t maxRetries;     ///< Retry budget: number of retries of a publication before giving up on it (0 for no limit).
+} Trackle_RetryPolicy_t;
+
+/**
+ * @brief Default retry policy.
+ */
+#define TRACKLE_RETRY_POLICY_DEFAULT() \
+    {                                  \
+        .initialDelayMs = 1000,        \
+        .maxDelayMs = 60000,           \
+        .multiplier = 2,               \
+        .jitterPercent = 20,           \
+        .maxRetries = 0,               \
+    }
+
+/**
+ * @brief Counters of the publications.
+ */
+typedef struct
+{
+    uint32_t published; ///< Publications done successfully.
+    uint32_t failures;  ///< Failed attempts of publication.
+    uint32_t retries;   ///< Attempts that were retries of a failed publication.
+    uint32_t dropped;   ///< Publications given up after exhausting the retry budget.
+    uint32_t throttled; ///< Rounds in which publications were held back by the bandwidth budget (properties only).
+} Trackle_PublishStats_t;
+
+#endif
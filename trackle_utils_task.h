@@ -0,0 +1,50 @@
+#ifndef TRACKLE_UTILS_TASK_H
+#define TRACKLE_UTILS_TASK_H
+
+#include <stdbool.h>
+#include <esp_types.h>
+
+#include <freertos/FreeRTOS.h>
+
+/**
+ *
+ * @file trackle_utils_task.h
+ * @brief Datatypes for configuring and monitoring the tasks started by the component.
+ *
+ * Every function that starts a task has a variant accepting a \ref Trackle_TaskConfig_t, and every task can be
+ * monitored through a \ref Trackle_TaskStats_t, to size its stack and check how long its loops take.
+ *
+ * The CPU time of the loops is measured with the run-time counter of FreeRTOS, only available when its run-time
+ * statistics are enabled (CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS) with the default esp_timer clock. Otherwise the CPU
+ * times are 0, and only the wall-clock durations are measured: these include the time other tasks ran meanwhile and
+ * the time spent waiting for the network while publishing.
+ *
+ */
+
+/**
+ * @brief Configuration of a task.
+ */
+typedef struct
+{
+    uint32_t stackSize;   ///< Size of the stack of the task [bytes].
+    UBaseType_t priority; ///< FreeRTOS priority of the task.
+    BaseType_t coreId;    ///< Core where the task is pinned (tskNO_AFFINITY to let it run on any core).
+    uint32_t periodMs;    ///< Period of the loop of the task [ms]. It must be at least one tick long.
+} Trackle_TaskConfig_t;
+
+/**
+ * @brief Statistics of a task.
+ */
+typedef struct
+{
+    uint32_t stackHighWaterMark;  ///< Minimum amount of free stack since the task started [bytes].
+    uint32_t loops;               ///< Number of loops done since the task started.
+    uint32_t lastLoopCpuTimeUs;   ///< CPU time used by the latest loop [us] (0 without run-time statistics).
+    uint32_t maxLoopCpuTimeUs;    ///< CPU time used by the most expensive loop [us] (0 without run-time statistics).
+    uint64_t totalLoopCpuTimeUs;  ///< Sum of the CPU times used by all the loops [us] (0 without run-time statistics).
+    uint32_t lastLoopWallTimeUs;  ///< Wall-clock duration of the latest loop, including the time other tasks ran meanwhile [us].
+    uint32_t maxLoopWallTimeUs;   ///< Wall-clock duration of the longest loop [us].
+    uint64_t totalLoopWallTimeUs; ///< Sum of the wall-clock durations of all the loops [us].
+} Trackle_TaskStats_t;
+
+#endif
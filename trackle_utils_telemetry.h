@@ -0,0 +1,63 @@
+#ifndef TRACKLE_UTILS_TELEMETRY_H
+#define TRACKLE_UTILS_TELEMETRY_H
+
+#include <stdbool.h>
+#include <esp_types.h>
+
+#include <trackle_utils_task.h>
+
+/**
+ *
+ * @file trackle_utils_telemetry.h
+ * @brief Functions for running properties and notifications in a single task.
+ *
+ * By default, properties and notifications are published by two different tasks, started by \ref Trackle_Props_startTask and
+ * \ref Trackle_Notifications_startTask. On devices with little memory, \ref Trackle_Telemetry_startTask can be called instead
+ * of both of them, to publish properties and notifications from a single task and save the stack and the control block of the other one.
+ *
+ */
+
+/**
+ * @brief Default configuration of the telemetry task, used by \ref Trackle_Telemetry_startTask. The period is the one of the properties.
+ *
+ * The stack is as large as the one of each dedicated task, since the publication of a property or of a notification
+ * goes through the same calls: it isn't sized on a measurement. To size it for an application, run the task on the
+ * heaviest publications it makes (every engine in use, CBOR and JSON payloads, series, key dictionary), read the
+ * stack high water mark with \ref Trackle_Telemetry_getTaskStats, and reduce the stack by that amount minus a margin.
+ */
+#define TRACKLE_TELEMETRY_TASK_CONFIG_DEFAULT() \
+    {                                           \
+        .stackSize = 8192,                      \
+        .priority = tskIDLE_PRIORITY + 10,      \
+        .coreId = 1,                            \
+        .periodMs = 100,                        \
+    }
+
+/**
+ * @brief Default period of the notifications in the telemetry task [ms], used by \ref Trackle_Telemetry_startTask.
+ */
+#define TRACKLE_TELEMETRY_NOTIFICATIONS_PERIOD_MS_DEFAULT 1000
+
+/**
+ * @brief Start the task that publishes both properties and notifications. When both are due at the same time, notifications are published first.
+ * It must not be called together with \ref Trackle_Props_startTask or \ref Trackle_Notifications_startTask.
+ * @return true if task started successfully, false otherwise.
+ */
+bool Trackle_Telemetry_startTask();
+
+/**
+ * @brief Start the task that publishes both properties and notifications, with a custom configuration.
+ * @param config Configuration of the task, whose period is used for properties (see \ref TRACKLE_TELEMETRY_TASK_CONFIG_DEFAULT for the default one).
+ * @param notificationsPeriodMs Period used for notifications [ms]. It must be at least one tick long.
+ * @return true if task started successfully, false otherwise.
+ */
+bool Trackle_Telemetry_startTaskWithConfig(const Trackle_TaskConfig_t *config, uint32_t notificationsPeriodMs);
+
+/**
+ * @brief Get the statistics of the telemetry task, to tune its configuration.
+ * @param stats Structure where to store the statistics.
+ * @return true on success, false if the task wasn't started.
+ */
+bool Trackle_Telemetry_getTaskStats(Trackle_TaskStats_t *stats);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef TRACKLE_UTILS_TIME_H
+#define TRACKLE_UTILS_TIME_H
+
+#include <esp_types.h>
+
+/**
+ *
+ * @file trackle_utils_time.h
+ * @brief Datatypes and functions for choosing the time base of properties and notifications.
+ *
+ * Debounce, deadlines of the groups, budget and the other timings of the engines are measured in microseconds since boot
+ * on a 64-bit monotonic clock, so they never wrap. By default the clock is esp_timer; \ref Trackle_Time_setSource
+ * replaces it, e.g. to run the engines against a simulated clock on the host.
+ *
+ */
+
+/**
+ * @brief Source of the time of the engines.
+ * @return Monotonic time [µs], starting from any value.
+ */
+typedef int64_t (*Trackle_TimeSource_t)(void);
+
+/**
+ * @brief Set the source of the time of the engines. Must be called before starting the tasks.
+ * @param source Source of the time, or NULL to restore esp_timer_get_time.
+ */
+void Trackle_Time_setSource(Trackle_TimeSource_t source);
+
+/**
+ * @brief Get the current time of the engines.
+ * @return Time given by the source [µs].
+ */
+int64_t Trackle_Time_getUs();
+
+#endif